@@ -17,14 +17,64 @@
  */
 
 #define _CRT_NONSTDC_NO_DEPRECATE
+#define _GNU_SOURCE
 
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
 
 #if defined _WIN32
 #include <Windows.h>
+#include <Psapi.h>
+#else
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <errno.h>
+#include <glob.h>
+#if defined __linux__
+#include <sys/syscall.h>
+#include <sys/sendfile.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/fs.h>
+#include <poll.h>
+#include <signal.h>
+#if defined __has_include
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif // __has_include(<linux/io_uring.h>)
+#endif // __has_include
+#if defined IORING_FILE_INDEX_ALLOC && defined __NR_io_uring_setup && defined __NR_io_uring_enter && defined __NR_io_uring_register
+#define HAVE_IO_URING // registered file slots for IORING_OP_OPENAT came with IORING_FILE_INDEX_ALLOC
+#endif // IORING_FILE_INDEX_ALLOC
+#endif // __linux__
+
+#define strcmpi strcasecmp
+#endif // _WIN32
+
+#if defined HAVE_ZLIB
+#include <zlib.h>
+#endif // HAVE_ZLIB
+
+#if defined _WIN32
+#define PATH_SEPARATOR '\\'
+#define CURRENT_DIRECTORY_FD 0
+#else
+#define PATH_SEPARATOR '/'
+#define CURRENT_DIRECTORY_FD AT_FDCWD
 #endif // _WIN32
 
 enum UDKPackage_Extension
@@ -41,9 +91,19 @@ uint32_t package_name = 0;
 uint32_t package_GUID[4];
 enum UDKPackage_Extension package_extension = ext_UNKNOWN;
 
-/** Name table */
+/** Name table; names are stored back to back in one arena */
 uint32_t name_table_size = 0;
-char **name_table = NULL;
+char *name_table = NULL;
+uint32_t *name_table_offsets = NULL;
+
+/** Name index; open addressing over case-folded hashes */
+struct UDKName_Slot
+{
+	uint32_t hash;
+	uint32_t index;
+};
+struct UDKName_Slot *name_index = NULL;
+uint32_t name_index_mask = 0;
 
 #define INVALID_NAME UINT32_MAX
 
@@ -61,64 +121,46 @@ size_t packages_imported = 0;
 
 /** Against list */
 uint32_t against_list_size = 0;
-uint32_t **against_list = NULL;
+uint32_t *against_list = NULL; // 4 words per GUID, sorted
+uint32_t *against_index = NULL; // open addressing; slots hold against_list indices
+uint32_t against_index_mask = 0;
+uint32_t *against_list_names = NULL; // string pool offset per GUID; NULL when names are unknown
+char *against_list_string_pool = NULL;
+uint32_t against_list_string_pool_size = 0;
 
 /** Package table */
 struct UDKPackage
 {
 	uint32_t name_index;
+	char *name; // only set when name_index is INVALID_NAME
 	uint32_t GUID[4];
 	char *filename;
 	enum UDKPackage_Extension extension;
 };
 struct UDKPackage *package_table;
 
-/** Dependency table */
-struct UDKPackage_Dependency
-{
-	struct UDKPackage *package;
-	struct UDKPackage_Dependency *next;
-};
+/** Dependency table; entries point into package_table or transitive_package_table */
+struct UDKPackage **dependency_list = NULL;
 uint32_t dependency_list_size = 0;
-struct UDKPackage_Dependency *dependency_list_head = NULL;
-struct UDKPackage_Dependency *dependency_list_last = NULL;
+uint32_t dependency_list_capacity = 0;
 
 /** Game package table */
 struct UDKPackage_Game
 {
-	char *name;
+	char *name; // shares filename's allocation
 	uint32_t GUID[4];
-
-	struct UDKPackage_Game *next;
+	char *filename;
+	enum UDKPackage_Extension extension;
 };
+struct UDKPackage_Game *game_package_table = NULL;
 size_t game_package_table_size = 0;
-struct UDKPackage_Game *game_package_table_head = NULL;
-struct UDKPackage_Game *game_package_table_last = NULL;
-
-/** Utility Functions */
+size_t game_package_table_capacity = 0;
 
-const char *str_find_suffix(const char *str, const char *suffix)
-{
-	const char *str_end = str;
-	const char *suffix_end = suffix;
-
-	while (*str_end != '\0')
-		++str_end;
-
-	while (*suffix_end != '\0')
-		++suffix_end;
-
-	if (str_end - str < suffix_end - suffix) // Too short to contain suffix
-		return NULL;
-
-	while (suffix_end != suffix)
-	{
-		if (*--str_end != *--suffix_end)
-			return NULL;
-	}
+/** Game package index; open addressing by case-insensitive name, slots hold table indices (SIZE_MAX if empty) */
+size_t *game_package_index = NULL;
+size_t game_package_index_mask = 0;
 
-	return str_end;
-}
+/** Utility Functions */
 
 bool streql_2ptr(const char *filename, const char *filename_end, const char *package_name)
 {
@@ -131,25 +173,9 @@ bool streql_2ptr(const char *filename, const char *filename_end, const char *pac
 	return *package_name == '\0';
 }
 
-void read_guid(uint32_t *GUID, FILE *in_file)
-{
-	// seek to string size
-	fseek(in_file, 0x0C, SEEK_SET);
-
-	// read string size (repurpose GUID[0])
-	fread(GUID, sizeof(uint32_t), 1, in_file);
-
-	// seek to GUID
-	fseek(in_file, *GUID + 0x30, SEEK_CUR);
-
-	// read GUID
-	fread(GUID, sizeof(uint32_t), 4, in_file);
-}
-
 void free_UDKPackage_Game(struct UDKPackage_Game *package)
 {
-	free(package->name);
-	free(package);
+	free(package->filename);
 }
 
 enum UDKPackage_Extension get_extension_from_filename(const char *filename, size_t filename_length)
@@ -161,11 +187,11 @@ enum UDKPackage_Extension get_extension_from_filename(const char *filename, size
 		{
 			++filename;
 
-			if (strcmpi(filename, "udk"))
+			if (strcmpi(filename, "udk") == 0)
 				return ext_UDK;
-			if (strcmpi(filename, "upk"))
+			if (strcmpi(filename, "upk") == 0)
 				return ext_UPK;
-			if (strcmpi(filename, "u"))
+			if (strcmpi(filename, "u") == 0)
 				return ext_U;
 
 			return ext_UNKNOWN;
@@ -190,589 +216,6853 @@ const char *extension_as_string(enum UDKPackage_Extension extension)
 	}
 }
 
-/** Name Table Functions */
+/** Threading */
+
+#if defined _WIN32
+typedef HANDLE thread_t;
+typedef CRITICAL_SECTION mutex_t;
+typedef CONDITION_VARIABLE cond_t;
+
+#define mutex_init(mutex) InitializeCriticalSection(mutex)
+#define mutex_destroy(mutex) DeleteCriticalSection(mutex)
+#define mutex_lock(mutex) EnterCriticalSection(mutex)
+#define mutex_unlock(mutex) LeaveCriticalSection(mutex)
+#define cond_init(cond) InitializeConditionVariable(cond)
+#define cond_destroy(cond) ((void) 0)
+#define cond_wait(cond, mutex) SleepConditionVariableCS(cond, mutex, INFINITE)
+#define cond_signal(cond) WakeConditionVariable(cond)
+#define cond_broadcast(cond) WakeAllConditionVariable(cond)
+#else
+typedef pthread_t thread_t;
+typedef pthread_mutex_t mutex_t;
+typedef pthread_cond_t cond_t;
+
+#define mutex_init(mutex) pthread_mutex_init(mutex, NULL)
+#define mutex_destroy(mutex) pthread_mutex_destroy(mutex)
+#define mutex_lock(mutex) pthread_mutex_lock(mutex)
+#define mutex_unlock(mutex) pthread_mutex_unlock(mutex)
+#define cond_init(cond) pthread_cond_init(cond, NULL)
+#define cond_destroy(cond) pthread_cond_destroy(cond)
+#define cond_wait(cond, mutex) pthread_cond_wait(cond, mutex)
+#define cond_signal(cond) pthread_cond_signal(cond)
+#define cond_broadcast(cond) pthread_cond_broadcast(cond)
+#endif // _WIN32
 
-void read_name_table(FILE *file)
+size_t get_processor_count()
 {
-	uint32_t tmp;
-	size_t index;
+#if defined _WIN32
+	SYSTEM_INFO info;
 
-	// seek to string size
-	fseek(file, 0x0C, SEEK_SET);
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
 
-	// read string size
-	fread(&tmp, sizeof(tmp), 1, file);
+	return count > 0 ? (size_t) count : 1;
+#endif // _WIN32
+}
 
-	// seek to name count
-	fseek(file, tmp + 0x04, SEEK_CUR);
+struct Work_Pool;
 
-	// read name count
-	fread(&name_table_size, sizeof(name_table_size), 1, file);
+struct Work_Task
+{
+	void (*function)(struct Work_Pool *pool, size_t worker, void *data);
+	void *data;
+};
 
-	// read name table offset
-	fread(&tmp, sizeof(tmp), 1, file);
+/** Per-worker deque; the owner pushes and pops at the tail, thieves take from the head */
+struct Work_Queue
+{
+	mutex_t lock;
+	struct Work_Task *tasks;
+	size_t head;
+	size_t tail;
+	size_t capacity;
+};
 
-	// seek to name table
-	fseek(file, tmp, SEEK_SET);
+struct Work_Thread
+{
+	struct Work_Pool *pool;
+	size_t worker;
+	thread_t thread;
+};
 
-	// allocate array of char pointers
-	if (name_table != NULL)
-		free(name_table);
-	name_table = (char **) malloc(sizeof(char *) * name_table_size);
+struct Work_Pool
+{
+	struct Work_Queue *queues;
+	struct Work_Thread *threads;
+	size_t thread_count;
+
+	mutex_t lock;
+	cond_t work_available;
+	cond_t work_done;
+	size_t pending; // tasks queued or running
+	size_t generation; // incremented on every push
+	bool shutdown;
+};
 
-	// read name table
-	for (index = 0; index != name_table_size; ++index)
-	{
-		// read name length (includes null term)
-		fread(&tmp, sizeof(tmp), 1, file);
+size_t thread_count = 0; // 0 = one per processor
+struct Work_Pool *work_pool = NULL;
 
-		// allocate string buffer & copy string from file
-		name_table[index] = (char *) malloc(sizeof(char) * tmp);
-		fread(name_table[index], sizeof(char), tmp, file);
+bool work_queue_pop(struct Work_Queue *queue, struct Work_Task *task)
+{
+	bool result = false;
 
-		// skip Object Flags
-		fseek(file, 0x08, SEEK_CUR);
+	mutex_lock(&queue->lock);
+	if (queue->tail != queue->head)
+	{
+		*task = queue->tasks[--queue->tail];
+		result = true;
 	}
+	mutex_unlock(&queue->lock);
+
+	return result;
 }
 
-void print_name_table(FILE *out)
+bool work_queue_steal(struct Work_Queue *queue, struct Work_Task *task)
 {
-	size_t index;
+	bool result = false;
 
-	for (index = 0; index != name_table_size; ++index)
-		fprintf(out, "%u: %s\r\n", index, name_table[index]);
+	mutex_lock(&queue->lock);
+	if (queue->tail != queue->head)
+	{
+		*task = queue->tasks[queue->head++];
+		result = true;
+	}
+	mutex_unlock(&queue->lock);
+
+	return result;
 }
 
-uint32_t find_name(const char *name)
+bool work_pool_take(struct Work_Pool *pool, size_t worker, struct Work_Task *task)
 {
-	uint32_t index;
+	size_t index;
 
-	for (index = 0; index != name_table_size; ++index)
-		if (strcmp(name, name_table[index]) == 0)
-			return index;
+	if (work_queue_pop(&pool->queues[worker], task))
+		return true;
 
-	return INVALID_NAME;
+	for (index = 1; index < pool->thread_count; ++index)
+		if (work_queue_steal(&pool->queues[(worker + index) % pool->thread_count], task))
+			return true;
+
+	return false;
 }
 
-uint32_t find_name_2ptr(const char *name_start, const char *name_end)
+void work_pool_execute(struct Work_Pool *pool, size_t worker, struct Work_Task *task)
 {
-	uint32_t index;
-
-	for (index = 0; index != name_table_size; ++index)
-		if (streql_2ptr(name_start, name_end, name_table[index]))
-			return index;
+	task->function(pool, worker, task->data);
 
-	return INVALID_NAME;
+	mutex_lock(&pool->lock);
+	if (--pool->pending == 0)
+		cond_broadcast(&pool->work_done);
+	mutex_unlock(&pool->lock);
 }
 
-uint32_t name_from_filename(const char *filename, size_t filename_length)
+void work_pool_run(struct Work_Thread *thread)
 {
-	const char *start_name = NULL;
-	const char *end_name = NULL;
+	struct Work_Pool *pool = thread->pool;
+	struct Work_Task task;
+	size_t generation = 0;
 
-	filename += filename_length;
-	while (filename_length != 0)
+	while (true)
 	{
-		--filename;
+		if (work_pool_take(pool, thread->worker, &task))
+		{
+			work_pool_execute(pool, thread->worker, &task);
+			continue;
+		}
 
-		if (*filename == '.' && end_name == NULL)
-			end_name = filename;
+		// Nothing to take; sleep unless something was pushed since the last scan
+		mutex_lock(&pool->lock);
+		while (pool->shutdown == false && pool->generation == generation)
+			cond_wait(&pool->work_available, &pool->lock);
+		generation = pool->generation;
 
-		if (*filename == '\\' || *filename == '/')
+		if (pool->shutdown)
 		{
-			start_name = ++filename;
+			mutex_unlock(&pool->lock);
 			break;
 		}
-
-		--filename_length;
+		mutex_unlock(&pool->lock);
 	}
-
-	if (start_name == NULL)
-		start_name = filename;
-
-	if (end_name == NULL)
-		return find_name(start_name);
-
-	return find_name_2ptr(start_name, end_name);
 }
 
-/** Import Table Functions */
-
-void read_import_table(FILE *file)
+#if defined _WIN32
+DWORD WINAPI work_pool_thread(LPVOID data)
 {
-	uint32_t tmp;
-
-	// seek to string size
-	fseek(file, 0x0C, SEEK_SET);
+	work_pool_run((struct Work_Thread *) data);
+	return 0;
+}
+#else
+void *work_pool_thread(void *data)
+{
+	work_pool_run((struct Work_Thread *) data);
+	return NULL;
+}
+#endif // _WIN32
 
-	// read string size
-	fread(&tmp, sizeof(tmp), 1, file);
+struct Work_Pool *work_pool_create(size_t count)
+{
+	struct Work_Pool *pool;
+	size_t index;
 
-	// seek to import count
-	fseek(file, tmp + 0x14, SEEK_CUR);
+	if (count == 0)
+		count = get_processor_count();
+
+	pool = (struct Work_Pool *) malloc(sizeof(struct Work_Pool));
+	pool->thread_count = count;
+	pool->queues = (struct Work_Queue *) calloc(count, sizeof(struct Work_Queue));
+	pool->threads = (struct Work_Thread *) calloc(count, sizeof(struct Work_Thread));
+	pool->pending = 0;
+	pool->generation = 0;
+	pool->shutdown = false;
+	mutex_init(&pool->lock);
+	cond_init(&pool->work_available);
+	cond_init(&pool->work_done);
+
+	// Every queue must exist before the first thread starts stealing from it
+	for (index = 0; index != count; ++index)
+		mutex_init(&pool->queues[index].lock);
+
+	for (index = 0; index != count; ++index)
+	{
+		pool->threads[index].pool = pool;
+		pool->threads[index].worker = index;
 
-	// read import count
-	fread(&import_table_size, sizeof(import_table_size), 1, file);
+#if defined _WIN32
+		pool->threads[index].thread = CreateThread(NULL, 0, work_pool_thread, &pool->threads[index], 0, NULL);
+#else
+		pthread_create(&pool->threads[index].thread, NULL, work_pool_thread, &pool->threads[index]);
+#endif // _WIN32
+	}
 
-	// read import table offset
-	fread(&tmp, sizeof(tmp), 1, file);
+	return pool;
+}
 
-	// seek to import table
-	fseek(file, tmp, SEEK_SET);
+/** Queues a task; worker is the calling worker's index, or SIZE_MAX from outside the pool */
+void work_pool_push(struct Work_Pool *pool, size_t worker, void (*function)(struct Work_Pool *, size_t, void *), void *data)
+{
+	struct Work_Queue *queue;
 
-	// allocate array of UDKImport objects
-	if (import_table != NULL)
-		free(import_table);
-	import_table = (struct UDKImport *) malloc(sizeof(struct UDKImport) * import_table_size);
+	mutex_lock(&pool->lock);
+	queue = &pool->queues[(worker < pool->thread_count ? worker : pool->generation) % pool->thread_count];
+	++pool->pending;
+	++pool->generation;
 
-	// read import table
-	// fread(import_table + tmp, sizeof(struct UDKImport), import_table_size, file);
-	for (tmp = 0; tmp != import_table_size; ++tmp)
+	mutex_lock(&queue->lock);
+	if (queue->tail == queue->capacity)
 	{
-		// Seek after read because:
-		//	"Name indexes work the same way as #Index but since Unreal Engine 3 indexes referencing a name, have a another Int32 followed after the index."
-		// Source: http://eliotvu.com/page/unreal-package-file-format
+		if (queue->head != 0)
+		{
+			memmove(queue->tasks, queue->tasks + queue->head, sizeof(struct Work_Task) * (queue->tail - queue->head));
+			queue->tail -= queue->head;
+			queue->head = 0;
+		}
+		else
+		{
+			queue->capacity = queue->capacity == 0 ? 64 : queue->capacity * 2;
+			queue->tasks = (struct Work_Task *) realloc(queue->tasks, sizeof(struct Work_Task) * queue->capacity);
+		}
+	}
+	queue->tasks[queue->tail].function = function;
+	queue->tasks[queue->tail].data = data;
+	++queue->tail;
+	mutex_unlock(&queue->lock);
 
-		fread(&import_table[tmp].package_name_index, sizeof(uint32_t), 1, file);
-		fseek(file, 0x04, SEEK_CUR);
+	cond_signal(&pool->work_available);
+	mutex_unlock(&pool->lock);
+}
 
-		fread(&import_table[tmp].class_name_index, sizeof(uint32_t), 1, file);
-		fseek(file, 0x04, SEEK_CUR);
+/** Blocks until every queued task (including tasks queued by tasks) has completed */
+void work_pool_wait(struct Work_Pool *pool)
+{
+	mutex_lock(&pool->lock);
+	while (pool->pending != 0)
+		cond_wait(&pool->work_done, &pool->lock);
+	mutex_unlock(&pool->lock);
+}
 
-		fread(&import_table[tmp].package_reference, sizeof(int32_t), 1, file);
+/** Tracks a subset of the pool's tasks; tasks call work_group_done when finished */
+struct Work_Group
+{
+	size_t remaining;
+};
 
-		fread(&import_table[tmp].object_name_index, sizeof(uint32_t), 1, file);
-		fseek(file, 0x04, SEEK_CUR);
+void work_group_add(struct Work_Pool *pool, struct Work_Group *group)
+{
+	mutex_lock(&pool->lock);
+	++group->remaining;
+	mutex_unlock(&pool->lock);
+}
 
-		if (import_table[tmp].package_reference == 0)
-			++packages_imported;
-	}
+void work_group_done(struct Work_Pool *pool, struct Work_Group *group)
+{
+	mutex_lock(&pool->lock);
+	if (--group->remaining == 0)
+		cond_broadcast(&pool->work_done);
+	mutex_unlock(&pool->lock);
 }
 
-void print_import_table(FILE *out)
+/** Waits for a group, running queued tasks meanwhile; unlike work_pool_wait this is safe to call from inside a task */
+void work_group_wait(struct Work_Pool *pool, size_t worker, struct Work_Group *group)
 {
-	size_t index;
-	struct UDKImport *itr = import_table;
+	struct Work_Task task;
 
-	for (index = 0; index != import_table_size; ++index, ++itr)
-		fprintf(out, "%u | Package: %s | Class: %s | Object: %s | Reference: %d\r\n", index, name_table[itr->package_name_index], name_table[itr->class_name_index], name_table[itr->object_name_index], itr->package_reference);
-} 
+	while (true)
+	{
+		mutex_lock(&pool->lock);
+		if (group->remaining == 0)
+		{
+			mutex_unlock(&pool->lock);
+			return;
+		}
+		mutex_unlock(&pool->lock);
 
-/** Against list */
+		if (work_pool_take(pool, worker < pool->thread_count ? worker : 0, &task))
+		{
+			work_pool_execute(pool, worker, &task);
+			continue;
+		}
+
+		// the rest of the group is running on other threads
+		mutex_lock(&pool->lock);
+		if (group->remaining != 0)
+			cond_wait(&pool->work_done, &pool->lock);
+		mutex_unlock(&pool->lock);
+	}
+}
 
-void read_against_list(FILE *against_file)
+void work_pool_destroy(struct Work_Pool *pool)
 {
-	uint32_t tmp;
+	size_t index;
 
-	fread(&against_list_size, sizeof(against_list_size), 1, against_file);
-	against_list = (uint32_t **) malloc(sizeof(uint32_t *) * against_list_size);
+	mutex_lock(&pool->lock);
+	pool->shutdown = true;
+	cond_broadcast(&pool->work_available);
+	mutex_unlock(&pool->lock);
 
-	for (tmp = 0; tmp != against_list_size; ++tmp)
+	for (index = 0; index != pool->thread_count; ++index)
 	{
-		against_list[tmp] = (uint32_t *) malloc(sizeof(uint32_t) * 4);
-		fread(against_list[tmp], sizeof(uint32_t), 4, against_file);
+#if defined _WIN32
+		WaitForSingleObject(pool->threads[index].thread, INFINITE);
+		CloseHandle(pool->threads[index].thread);
+#else
+		pthread_join(pool->threads[index].thread, NULL);
+#endif // _WIN32
+		mutex_destroy(&pool->queues[index].lock);
+		free(pool->queues[index].tasks);
 	}
+
+	mutex_destroy(&pool->lock);
+	cond_destroy(&pool->work_available);
+	cond_destroy(&pool->work_done);
+	free(pool->queues);
+	free(pool->threads);
+	free(pool);
 }
 
-void build_against_list()
+struct Work_Pool *get_work_pool()
 {
-	struct UDKPackage_Game *package = game_package_table_head;
-	uint32_t **itr;
+	if (work_pool == NULL)
+		work_pool = work_pool_create(thread_count);
 
-	against_list_size = game_package_table_size;
-	against_list = (uint32_t **) malloc(sizeof(uint32_t *) * against_list_size);
-	itr = against_list;
+	return work_pool;
+}
 
-	while (package != NULL)
-	{
-		*itr = (uint32_t *) malloc(sizeof(uint32_t) * 4);
+/** Statistics */
+
+/**
+ * -stats reports wall time, files opened, bytes read, mapped and written and an estimate of the syscalls issued for each
+ * phase of main, then the process's peak RSS; -trace writes the same phases as Chrome trace events. Counters are only
+ * touched when stats are enabled, and live in shared memory so batch workers add to the parent's totals.
+ *
+ * Syscalls are counted where the code issues them, by what each call site is expected to cost (a directory read is an
+ * open, its getdents64 calls and a close), not traced, so the libc and kernel can differ. Peak RSS is the high-water
+ * mark of the process and its batch workers; the OS doesn't reset it, so it can't be split into phases.
+ */
 
-		memcpy(*itr, package->GUID, sizeof(uint32_t) * 4);
+#define STATS_MAX_PHASES 32
 
-		++itr;
-		package = package->next;
-	}
-}
+enum Stat_Counter
+{
+	stat_files_opened,
+	stat_bytes_read,
+	stat_bytes_mapped,
+	stat_bytes_written,
+	stat_syscalls, // estimated at each call site
+	stat_counter_count
+};
 
-void write_against_list(FILE *against_file)
+const char *stat_counter_names[stat_counter_count] = { "files_opened", "bytes_read", "bytes_mapped", "bytes_written", "syscalls_estimated" };
+
+struct Stats_Phase
 {
-	uint32_t tmp;
+	const char *name;
+	uint64_t start;
+	uint64_t end;
+	uint64_t counters[stat_counter_count];
+};
 
-	fwrite(&against_list_size, sizeof(against_list_size), 1, against_file);
+uint64_t *stat_counters = NULL; // NULL unless -stats or -trace
+struct Stats_Phase stats_phases[STATS_MAX_PHASES];
+size_t stats_phase_count = 0;
+uint64_t stats_start = 0;
 
-	for (tmp = 0; tmp != against_list_size; ++tmp)
-		fwrite(against_list[tmp], sizeof(uint32_t), 4, against_file);
-}
+#if defined _WIN32
+#define stat_add(counter, value) (stat_counters != NULL ? (void) InterlockedExchangeAdd64((volatile LONG64 *) &stat_counters[counter], (LONG64) (value)) : (void) 0)
+#define stat_get(counter) ((uint64_t) InterlockedCompareExchange64((volatile LONG64 *) &stat_counters[counter], 0, 0))
+#else
+#define stat_add(counter, value) (stat_counters != NULL ? (void) __atomic_fetch_add(&stat_counters[counter], (uint64_t) (value), __ATOMIC_RELAXED) : (void) 0)
+#define stat_get(counter) __atomic_load_n(&stat_counters[counter], __ATOMIC_RELAXED)
+#endif // _WIN32
 
-bool is_in_against_list(uint32_t *GUID)
+uint64_t get_time_ns()
 {
-	uint32_t tmp;
+#if defined _WIN32
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
 
-	for (tmp = 0; tmp != against_list_size; ++tmp)
-		if (memcmp(GUID, against_list[tmp], sizeof(uint32_t) * 4) == 0)
-			return true;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (uint64_t) (counter.QuadPart / frequency.QuadPart) * 1000000000ULL + (uint64_t) (counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
+#else
+	struct timespec now;
 
-	return false;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif // _WIN32
 }
 
-/** Package Table Functions */
-
-void init_package_table()
+double elapsed_ms(uint64_t start)
 {
-	struct UDKPackage *itr;
-	struct UDKPackage *end;
-	size_t index = 0;
+	return (double) (get_time_ns() - start) / 1000000.0;
+}
 
-	package_table = (struct UDKPackage *) malloc(sizeof(struct UDKPackage) * packages_imported);
-	itr = package_table;
-	end = package_table + packages_imported;
+/** Peak resident set size in bytes, including the largest batch worker */
+uint64_t get_peak_rss()
+{
+#if defined _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
 
-	while (itr != end)
-	{
-		if (import_table[index].package_reference == 0)
-		{
-			memset(itr->GUID, 0, sizeof(itr->GUID));
-			itr->name_index = import_table[index].object_name_index;
-			itr->filename = NULL;
-			itr->extension = ext_UNKNOWN;
-			++itr;
-		}
-		++index;
-	}
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == FALSE)
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	uint64_t result = 0;
+
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		result = usage.ru_maxrss;
+	if (getrusage(RUSAGE_CHILDREN, &usage) == 0 && (uint64_t) usage.ru_maxrss > result)
+		result = usage.ru_maxrss;
+
+#if defined __APPLE__
+	return result;
+#else
+	return result * 1024; // kilobytes
+#endif // __APPLE__
+#endif // _WIN32
 }
 
+void enable_stats()
+{
 #if defined _WIN32
+	stat_counters = (uint64_t *) calloc(stat_counter_count, sizeof(uint64_t));
+#else
+	stat_counters = (uint64_t *) mmap(NULL, sizeof(uint64_t) * stat_counter_count, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (stat_counters == MAP_FAILED)
+		stat_counters = (uint64_t *) calloc(stat_counter_count, sizeof(uint64_t));
+#endif // _WIN32
 
-bool build_package_table(const char *directory)
+	stats_start = get_time_ns();
+}
+
+/** Starts timing a phase of main; phases don't nest */
+void begin_phase(const char *name)
 {
-	WIN32_FIND_DATA file_data;
-	HANDLE find_handle;
-	size_t directory_length = 0;
-	char *tmp;
-	size_t tmp_length;
-	size_t tmp_index;
-	FILE *tmp_file;
-	enum UDKPackage_Extension extension;
+	struct Stats_Phase *phase;
+	size_t index;
 
-	find_handle = FindFirstFile(directory, &file_data);
+	if (stat_counters == NULL || stats_phase_count == STATS_MAX_PHASES)
+		return;
 
-	if (find_handle == INVALID_HANDLE_VALUE)
-		return false; // Error: Bad handle
+	phase = &stats_phases[stats_phase_count];
+	phase->name = name;
+	phase->end = 0;
+	for (index = 0; index != stat_counter_count; ++index)
+		phase->counters[index] = stat_get(index);
+	phase->start = get_time_ns();
+}
 
-	do
-	{
-		if (file_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-		{
-			if (file_data.cFileName[0] != '.')
-			{
-				// Calculate string lengths
-				if (directory_length == 0)
-					directory_length = strlen(directory) - 1;
-				tmp_length = strlen(file_data.cFileName);
+void end_phase()
+{
+	struct Stats_Phase *phase;
+	size_t index;
 
-				tmp = (char *)malloc(sizeof(char) * (directory_length + tmp_length + 3));
+	if (stat_counters == NULL || stats_phase_count == STATS_MAX_PHASES)
+		return;
 
-				memcpy(tmp, directory, directory_length);
-				memcpy(tmp + directory_length, file_data.cFileName, tmp_length);
+	phase = &stats_phases[stats_phase_count++];
+	phase->end = get_time_ns();
+	for (index = 0; index != stat_counter_count; ++index)
+		phase->counters[index] = stat_get(index) - phase->counters[index];
+}
 
-				// Append wildcard and NULL terminator
-				tmp_length += directory_length;
-				tmp[tmp_length] = '\\';
-				tmp[tmp_length + 1] = '*';
-				tmp[tmp_length + 2] = '\0';
+void print_stats(FILE *out)
+{
+	struct Stats_Phase *phase;
+	uint64_t totals[stat_counter_count] = { 0 };
+	size_t index;
 
-				build_package_table(tmp);
-				free(tmp);
-			}
-		}
-		else
-		{
-			tmp = (char *) str_find_suffix(file_data.cFileName, ".upk");
-			if (tmp != NULL)
-				extension = ext_UPK;
-			else
-			{
-				tmp = (char *) str_find_suffix(file_data.cFileName, ".udk");
-				if (tmp != NULL)
-					extension = ext_UDK;
-				else
-				{
-					tmp = (char *) str_find_suffix(file_data.cFileName, ".u");
-					if (tmp != NULL)
-						extension = ext_U;
-					else
-						extension = ext_UNKNOWN;
-				}
-			}
+	fprintf(out, "%-20s %10s %8s %12s %12s %12s %10s\n", "phase", "wall (ms)", "files", "read", "mapped", "written", "~syscalls");
+	for (phase = stats_phases; phase != stats_phases + stats_phase_count; ++phase)
+	{
+		fprintf(out, "%-20s %10.3f %8llu %12llu %12llu %12llu %10llu\n", phase->name, (double) (phase->end - phase->start) / 1000000.0,
+			(unsigned long long) phase->counters[stat_files_opened], (unsigned long long) phase->counters[stat_bytes_read],
+			(unsigned long long) phase->counters[stat_bytes_mapped], (unsigned long long) phase->counters[stat_bytes_written],
+			(unsigned long long) phase->counters[stat_syscalls]);
 
-			if (tmp != NULL)
-			{
-				// check if package name matches a package in the table
-				for (tmp_index = 0; tmp_index != packages_imported; ++tmp_index)
-				{
-					if (streql_2ptr(file_data.cFileName, tmp, name_table[package_table[tmp_index].name_index]))
-					{
-						// Calculate string lengths
-						if (directory_length == 0)
-							directory_length = strlen(directory) - 1;
-						tmp_length = strlen(file_data.cFileName);
-
-						package_table[tmp_index].extension = extension;
-
-						package_table[tmp_index].filename = (char *) malloc(sizeof(char) * (directory_length + tmp_length + 1));
-
-						memcpy(package_table[tmp_index].filename, directory, directory_length);
-						memcpy(package_table[tmp_index].filename + directory_length, file_data.cFileName, tmp_length);
-						package_table[tmp_index].filename[directory_length + tmp_length] = '\0';
-
-						tmp_file = fopen(package_table[tmp_index].filename, "rb");
-						if (tmp_file != NULL)
-						{
-							read_guid(package_table[tmp_index].GUID, tmp_file);
-							fclose(tmp_file);
-						}
-						break;
-					}
-				}
-			}
-		}
+		for (index = 0; index != stat_counter_count; ++index)
+			totals[index] += phase->counters[index];
 	}
-	while (FindNextFile(find_handle, &file_data));
 
-	FindClose(find_handle);
-	return true;
+	fprintf(out, "%-20s %10.3f %8llu %12llu %12llu %12llu %10llu\n", "total", elapsed_ms(stats_start),
+		(unsigned long long) totals[stat_files_opened], (unsigned long long) totals[stat_bytes_read],
+		(unsigned long long) totals[stat_bytes_mapped], (unsigned long long) totals[stat_bytes_written],
+		(unsigned long long) totals[stat_syscalls]);
+	fprintf(out, "~syscalls are estimated per call site. Peak RSS (process and batch workers, whole run): %lluK\n", (unsigned long long) get_peak_rss() / 1024);
 }
 
-#endif // _WIN32
-
-void print_package_table(FILE *out)
+/** Writes the phases as complete ("X") events in the Chrome trace-event format, loadable in chrome://tracing or Perfetto */
+bool write_trace(const char *filename)
 {
+	struct Stats_Phase *phase;
+	FILE *out = fopen(filename, "wb");
 	size_t index;
-	struct UDKPackage *itr = package_table;
 
-	for (index = 0; index != packages_imported; ++index, ++itr)
+	if (out == NULL)
+		return false;
+
+	fputs("{\"traceEvents\":[\n", out);
+	for (phase = stats_phases; phase != stats_phases + stats_phase_count; ++phase)
 	{
-		fprintf(out, "%.8X%.8X%.8X%.8X | ", itr->GUID[0], itr->GUID[1], itr->GUID[2], itr->GUID[3]);
-		fputs(name_table[itr->name_index], out);
-		fputc('\n', out);
+		fprintf(out, "%s{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+			phase == stats_phases ? "" : ",\n", phase->name, (double) (phase->start - stats_start) / 1000.0, (double) (phase->end - phase->start) / 1000.0);
+
+		for (index = 0; index != stat_counter_count; ++index)
+			fprintf(out, "%s\"%s\":%llu", index == 0 ? "" : ",", stat_counter_names[index], (unsigned long long) phase->counters[index]);
+		fputs("}}", out);
 	}
-}
+	fprintf(out, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"peak_rss\":%llu}}\n", (unsigned long long) get_peak_rss());
 
-/** Dependency Table Functions */
+	return fclose(out) == 0;
+}
 
-void build_dependency_list()
-{
-	size_t index;
-	struct UDKPackage_Dependency *dependency;
+/** Output Writer */
 
+/**
+ * Table dumps are written through one large buffer flushed with fwrite, so a row costs a few copies into memory rather
+ * than a formatted stdio call per field, and nothing is built up as an intermediate string.
+ *
+ * Binary dump layout (native byte order, like the package cache):
+ *	uint32 magic, uint32 version, uint32 count
+ *	count * record
+ * Strings are a uint32 length followed by that many bytes, without a terminator. Records:
+ *	Names ("RXNT"): string name
+ *	Imports ("RXIT"): string package, string class, string object, int32 package reference
+ *	Packages ("RXPT"), game packages ("RXGT") and dependencies ("RXDL"): uint32 GUID[4], string name, string filename (empty if unresolved)
+ * JSON dumps hold one object per line, with GUIDs as 32 hex digits as in the text dumps.
+ */
+
+#define WRITER_BUFFER_SIZE (1 << 20)
+#define TABLE_DUMP_VERSION 1
+#define NAME_TABLE_MAGIC 0x544E5852 // "RXNT"
+#define IMPORT_TABLE_MAGIC 0x54495852 // "RXIT"
+#define PACKAGE_TABLE_MAGIC 0x54505852 // "RXPT"
+#define GAME_PACKAGE_TABLE_MAGIC 0x54475852 // "RXGT"
+#define DEPENDENCY_LIST_MAGIC 0x4C445852 // "RXDL"
+
+enum Output_Format
+{
+	format_text,
+	format_json,
+	format_binary
+};
+
+enum Output_Format output_format = format_text;
+
+struct Writer
+{
+	FILE *out;
+	char *buffer;
+	size_t size;
+	bool failed;
+};
+
+void open_writer(struct Writer *writer, FILE *out)
+{
+	writer->out = out;
+	writer->buffer = (char *) malloc(WRITER_BUFFER_SIZE);
+	writer->size = 0;
+	writer->failed = false;
+}
+
+void flush_writer(struct Writer *writer)
+{
+	if (writer->size != 0 && fwrite(writer->buffer, 1, writer->size, writer->out) != writer->size)
+		writer->failed = true;
+	writer->size = 0;
+}
+
+/** Flushes and frees the buffer; returns false if anything failed to write */
+bool close_writer(struct Writer *writer)
+{
+	flush_writer(writer);
+	free(writer->buffer);
+	writer->buffer = NULL;
+	return writer->failed == false && fflush(writer->out) == 0;
+}
+
+void writer_write(struct Writer *writer, const void *data, size_t size)
+{
+	if (size > WRITER_BUFFER_SIZE - writer->size)
+	{
+		flush_writer(writer);
+		if (size > WRITER_BUFFER_SIZE)
+		{
+			if (fwrite(data, 1, size, writer->out) != size)
+				writer->failed = true;
+			return;
+		}
+	}
+
+	memcpy(writer->buffer + writer->size, data, size);
+	writer->size += size;
+}
+
+void writer_putc(struct Writer *writer, char value)
+{
+	if (writer->size == WRITER_BUFFER_SIZE)
+		flush_writer(writer);
+	writer->buffer[writer->size++] = value;
+}
+
+void writer_puts(struct Writer *writer, const char *string)
+{
+	writer_write(writer, string, strlen(string));
+}
+
+void writer_put_uint32(struct Writer *writer, uint32_t value)
+{
+	writer_write(writer, &value, sizeof(value));
+}
+
+/** Decimal, without stdio */
+void writer_put_decimal(struct Writer *writer, int64_t value)
+{
+	char digits[24];
+	char *itr = digits + sizeof(digits);
+	uint64_t magnitude = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+
+	do
+	{
+		*--itr = (char) ('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	if (value < 0)
+		*--itr = '-';
+
+	writer_write(writer, itr, digits + sizeof(digits) - itr);
+}
+
+/** 32 uppercase hex digits, matching "%.8X%.8X%.8X%.8X" */
+void writer_put_guid(struct Writer *writer, const uint32_t *GUID)
+{
+	static const char hex_digits[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
+	char digits[32];
+	size_t index;
+	size_t digit;
+
+	for (index = 0; index != 4; ++index)
+		for (digit = 0; digit != 8; ++digit)
+			digits[index * 8 + digit] = hex_digits[(GUID[index] >> (28 - digit * 4)) & 0x0F];
+
+	writer_write(writer, digits, sizeof(digits));
+}
+
+/** Length-prefixed string for binary dumps; NULL is written as empty */
+void writer_put_binary_string(struct Writer *writer, const char *string)
+{
+	uint32_t length = string != NULL ? (uint32_t) strlen(string) : 0;
+
+	writer_put_uint32(writer, length);
+	writer_write(writer, string, length);
+}
+
+/** Quoted and escaped JSON string; NULL is written as null. Bytes above 0x7F are passed through */
+void writer_put_json_string(struct Writer *writer, const char *string)
+{
+	static const char hex_digits[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+	const char *run;
+	char escape[6] = { '\\', 'u', '0', '0', '0', '0' };
+
+	if (string == NULL)
+	{
+		writer_write(writer, "null", 4);
+		return;
+	}
+
+	writer_putc(writer, '"');
+	for (run = string; *string != '\0'; ++string)
+	{
+		if (*string != '"' && *string != '\\' && (unsigned char) *string >= 0x20)
+			continue;
+
+		// copy the plain run, then the escape
+		writer_write(writer, run, string - run);
+		run = string + 1;
+		if (*string == '"' || *string == '\\')
+		{
+			writer_putc(writer, '\\');
+			writer_putc(writer, *string);
+		}
+		else
+		{
+			escape[4] = hex_digits[(unsigned char) *string >> 4];
+			escape[5] = hex_digits[*string & 0x0F];
+			writer_write(writer, escape, sizeof(escape));
+		}
+	}
+	writer_write(writer, run, string - run);
+	writer_putc(writer, '"');
+}
+
+/** Starts a binary dump */
+void writer_put_dump_header(struct Writer *writer, uint32_t magic, uint32_t count)
+{
+	writer_put_uint32(writer, magic);
+	writer_put_uint32(writer, TABLE_DUMP_VERSION);
+	writer_put_uint32(writer, count);
+}
+
+/** One package row, shared by the package, game package and dependency dumps; the text form is the caller's */
+void writer_put_package_record(struct Writer *writer, const uint32_t *GUID, const char *name, const char *filename)
+{
+	if (output_format == format_binary)
+	{
+		writer_write(writer, GUID, sizeof(uint32_t) * 4);
+		writer_put_binary_string(writer, name);
+		writer_put_binary_string(writer, filename);
+		return;
+	}
+
+	writer_write(writer, "{\"guid\":\"", 9);
+	writer_put_guid(writer, GUID);
+	writer_write(writer, "\",\"name\":", 9);
+	writer_put_json_string(writer, name);
+	writer_write(writer, ",\"filename\":", 12);
+	writer_put_json_string(writer, filename);
+	writer_write(writer, "}\n", 2);
+}
+
+/** Writes a table to filename through print; returns false if it can't be opened or written */
+bool write_table(const char *filename, void (*print)(struct Writer *))
+{
+	struct Writer writer;
+	FILE *out = fopen(filename, "wb");
+	bool result;
+
+	if (out == NULL)
+		return false;
+
+	open_writer(&writer, out);
+	print(&writer);
+	result = close_writer(&writer);
+	return fclose(out) == 0 && result;
+}
+
+/** Directory Crawler */
+
+/** A package file found by the crawler */
+struct Crawl_Entry
+{
+	const char *directory; // includes trailing separator; may be empty
+	size_t directory_length;
+	const char *filename;
+	size_t filename_length;
+	const char *name_end; // start of the extension
+	enum UDKPackage_Extension extension;
+#if !defined _WIN32
+	int directory_fd;
+#endif // _WIN32
+};
+
+struct Crawl
+{
+	void (*on_package)(const struct Crawl_Entry *entry, void *context);
+	bool (*on_directory)(const char *path, void *context); // returns false to leave a queued directory unread; may be NULL
+	void *context;
+};
+
+struct Crawl_Directory
+{
+	struct Crawl *crawl;
+	struct Crawl_Directory **subdirectories; // found while reading this directory, queued once it is done
+	size_t subdirectory_count;
+	size_t subdirectory_capacity;
+	size_t path_length;
+	char path[1]; // includes trailing separator; may be empty
+};
+
+struct Crawl_Directory *new_Crawl_Directory(struct Crawl *crawl, const char *parent, size_t parent_length, const char *name, size_t name_length)
+{
+	struct Crawl_Directory *result;
+
+	result = (struct Crawl_Directory *) malloc(sizeof(struct Crawl_Directory) + parent_length + name_length + 1);
+	result->crawl = crawl;
+	result->subdirectories = NULL;
+	result->subdirectory_count = 0;
+	result->subdirectory_capacity = 0;
+	result->path_length = parent_length + name_length;
+
+	memcpy(result->path, parent, parent_length);
+	memcpy(result->path + parent_length, name, name_length);
+	if (result->path_length != 0 && result->path[result->path_length - 1] != '\\' && result->path[result->path_length - 1] != '/')
+		result->path[result->path_length++] = PATH_SEPARATOR;
+	result->path[result->path_length] = '\0';
+
+	return result;
+}
+
+/** Returns a newly allocated copy of the entry's full path */
+char *crawl_entry_path(const struct Crawl_Entry *entry)
+{
+	char *result = (char *) malloc(sizeof(char) * (entry->directory_length + entry->filename_length + 1));
+
+	memcpy(result, entry->directory, entry->directory_length);
+	memcpy(result + entry->directory_length, entry->filename, entry->filename_length);
+	result[entry->directory_length + entry->filename_length] = '\0';
+
+	return result;
+}
+
+/** Returns where the .upk/.udk/.u extension of name starts, or NULL if it isn't a package; scans back to the last '.' only */
+const char *find_package_extension(const char *name, size_t name_length, enum UDKPackage_Extension *extension)
+{
+	const char *dot = name + name_length;
+
+	while (dot != name)
+	{
+		if (*--dot != '.')
+			continue;
+
+		switch (name + name_length - dot)
+		{
+		case 2: // ".u"
+			if (dot[1] != 'u')
+				return NULL;
+			*extension = ext_U;
+			return dot;
+
+		case 4: // ".upk", ".udk"
+			if (dot[1] != 'u' || dot[3] != 'k' || (dot[2] != 'p' && dot[2] != 'd'))
+				return NULL;
+			*extension = dot[2] == 'p' ? ext_UPK : ext_UDK;
+			return dot;
+
+		default:
+			return NULL;
+		}
+	}
+
+	return NULL;
+}
+
+int compare_crawl_directories(const void *lhs, const void *rhs)
+{
+	return strcmp((*(struct Crawl_Directory *const *) rhs)->path, (*(struct Crawl_Directory *const *) lhs)->path);
+}
+
+void crawl_visit(struct Crawl_Directory *directory, const char *name, size_t name_length, bool is_directory, int directory_fd)
+{
+	struct Crawl_Entry entry;
+
+	if (is_directory)
+	{
+		if (name[0] == '.')
+			return;
+
+		if (directory->subdirectory_count == directory->subdirectory_capacity)
+		{
+			directory->subdirectory_capacity = directory->subdirectory_capacity == 0 ? 16 : directory->subdirectory_capacity * 2;
+			directory->subdirectories = (struct Crawl_Directory **) realloc(directory->subdirectories, sizeof(struct Crawl_Directory *) * directory->subdirectory_capacity);
+		}
+		directory->subdirectories[directory->subdirectory_count++] = new_Crawl_Directory(directory->crawl, directory->path, directory->path_length, name, name_length);
+		return;
+	}
+
+	entry.name_end = find_package_extension(name, name_length, &entry.extension);
+	if (entry.name_end == NULL)
+		return;
+
+	entry.directory = directory->path;
+	entry.directory_length = directory->path_length;
+	entry.filename = name;
+	entry.filename_length = name_length;
+#if !defined _WIN32
+	entry.directory_fd = directory_fd;
+#else
+	(void) directory_fd;
+#endif // _WIN32
+
+	directory->crawl->on_package(&entry, directory->crawl->context);
+}
+
+#if defined __linux__
+
+/** Record layout returned by getdents64 */
+struct linux_dirent64
+{
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[1];
+};
+
+#endif // __linux__
+
+void crawl_directory(struct Work_Pool *pool, size_t worker, void *data)
+{
+	struct Crawl_Directory *directory = (struct Crawl_Directory *) data;
+	size_t index;
+	bool skipped = directory->crawl->on_directory != NULL && directory->crawl->on_directory(directory->path, directory->crawl->context) == false;
+
+#if defined _WIN32
+	WIN32_FIND_DATA file_data;
+	HANDLE find_handle;
+	char *search_path;
+
+	search_path = (char *) malloc(sizeof(char) * (directory->path_length + 2));
+	memcpy(search_path, directory->path, directory->path_length);
+	search_path[directory->path_length] = '*';
+	search_path[directory->path_length + 1] = '\0';
+
+	find_handle = skipped ? INVALID_HANDLE_VALUE : FindFirstFile(search_path, &file_data);
+	free(search_path);
+	stat_add(stat_syscalls, 1);
+
+	if (find_handle != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			crawl_visit(directory, file_data.cFileName, strlen(file_data.cFileName), (file_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0, 0);
+			stat_add(stat_syscalls, 1);
+		} while (FindNextFile(find_handle, &file_data));
+
+		FindClose(find_handle);
+		stat_add(stat_syscalls, 1);
+	}
+#else
+	int directory_fd;
+	struct stat file_stat;
+	bool is_directory;
+#if defined __linux__
+	char buffer[32768];
+	long length;
+	long offset;
+	struct linux_dirent64 *file_data;
+#else
+	DIR *directory_stream;
+	struct dirent *file_data;
+#endif // __linux__
+
+	directory_fd = skipped ? -1 : open(directory->path_length == 0 ? "." : directory->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	stat_add(stat_syscalls, 1);
+	if (directory_fd >= 0)
+	{
+#if defined __linux__
+		while ((length = syscall(SYS_getdents64, directory_fd, buffer, sizeof(buffer))) > 0)
+		{
+			stat_add(stat_syscalls, 1);
+			for (offset = 0; offset < length; offset += file_data->d_reclen)
+			{
+				file_data = (struct linux_dirent64 *) (buffer + offset);
+#else
+		directory_stream = fdopendir(directory_fd);
+		if (directory_stream != NULL)
+		{
+			while ((file_data = readdir(directory_stream)) != NULL)
+			{
+#endif // __linux__
+				if (file_data->d_type == DT_DIR)
+					is_directory = true;
+				else if (file_data->d_type == DT_REG)
+					is_directory = false;
+				else if (file_data->d_type == DT_UNKNOWN || file_data->d_type == DT_LNK)
+				{
+					stat_add(stat_syscalls, 1);
+					if (fstatat(directory_fd, file_data->d_name, &file_stat, 0) != 0)
+						continue;
+
+					// Don't follow directory symlinks; they can form cycles
+					if (S_ISDIR(file_stat.st_mode) && file_data->d_type == DT_LNK)
+						continue;
+
+					is_directory = S_ISDIR(file_stat.st_mode);
+				}
+				else
+					continue;
+
+				crawl_visit(directory, file_data->d_name, strlen(file_data->d_name), is_directory, directory_fd);
+			}
+		}
+
+		stat_add(stat_syscalls, 2); // final getdents64 or readdir, and close
+#if defined __linux__
+		close(directory_fd);
+#else
+		if (directory_stream != NULL)
+			closedir(directory_stream);
+		else
+			close(directory_fd);
+#endif // __linux__
+	}
+#endif // _WIN32
+
+	// Highest path first, so this worker takes the lowest next and on_directory sees directories in roughly sorted order
+	if (directory->subdirectory_count > 1)
+		qsort(directory->subdirectories, directory->subdirectory_count, sizeof(struct Crawl_Directory *), compare_crawl_directories);
+	for (index = 0; index != directory->subdirectory_count; ++index)
+		work_pool_push(pool, worker, crawl_directory, directory->subdirectories[index]);
+
+	free(directory->subdirectories);
+	free(directory);
+}
+
+/** Walks directory on the work pool, invoking on_package concurrently for every .upk/.udk/.u file found in every directory on_directory accepts */
+bool crawl_packages(const char *directory, void (*on_package)(const struct Crawl_Entry *, void *), bool (*on_directory)(const char *, void *), void *context)
+{
+	struct Crawl crawl;
+	struct Work_Pool *pool;
+
+#if defined _WIN32
+	if (*directory != '\0' && GetFileAttributes(directory) == INVALID_FILE_ATTRIBUTES)
+		return false; // Error: Bad directory
+#else
+	struct stat directory_stat;
+
+	if (stat(*directory == '\0' ? "." : directory, &directory_stat) != 0 || S_ISDIR(directory_stat.st_mode) == false)
+		return false; // Error: Bad directory
+#endif // _WIN32
+
+	crawl.on_package = on_package;
+	crawl.on_directory = on_directory;
+	crawl.context = context;
+
+	pool = get_work_pool();
+	work_pool_push(pool, SIZE_MAX, crawl_directory, new_Crawl_Directory(&crawl, "", 0, directory, strlen(directory)));
+	work_pool_wait(pool);
+
+	return true;
+}
+
+/** Mapped Files */
+
+struct Mapped_File
+{
+	const uint8_t *data;
+	size_t size;
+#if defined _WIN32
+	HANDLE mapping;
+#endif // _WIN32
+};
+
+void unmap_file(struct Mapped_File *file)
+{
+	if (file->data == NULL)
+		return;
+
+#if defined _WIN32
+	UnmapViewOfFile(file->data);
+	CloseHandle(file->mapping);
+	stat_add(stat_syscalls, 2);
+#else
+	munmap((void *) file->data, file->size);
+	stat_add(stat_syscalls, 1);
+#endif // _WIN32
+
+	file->data = NULL;
+	file->size = 0;
+}
+
+/** Maps an entire file read-only; empty files fail */
+bool map_file(struct Mapped_File *file, const char *filename)
+{
+#if defined _WIN32
+	HANDLE handle;
+	LARGE_INTEGER file_size;
+#else
+	int fd;
+	struct stat file_stat;
+#endif // _WIN32
+
+	file->data = NULL;
+	file->size = 0;
+
+#if defined _WIN32
+	handle = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	stat_add(stat_syscalls, 1);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+	stat_add(stat_files_opened, 1);
+	stat_add(stat_syscalls, 4); // size, mapping, close, view
+
+	if (GetFileSizeEx(handle, &file_size) == FALSE || file_size.QuadPart == 0)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	file->mapping = CreateFileMapping(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(handle);
+	if (file->mapping == NULL)
+		return false;
+
+	file->data = (const uint8_t *) MapViewOfFile(file->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (file->data == NULL)
+	{
+		CloseHandle(file->mapping);
+		return false;
+	}
+	file->size = (size_t) file_size.QuadPart;
+	stat_add(stat_bytes_mapped, file->size);
+#else
+	fd = open(filename, O_RDONLY | O_CLOEXEC);
+	stat_add(stat_syscalls, 1);
+	if (fd < 0)
+		return false;
+	stat_add(stat_files_opened, 1);
+	stat_add(stat_syscalls, 3); // fstat, mmap, close
+
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	file->data = (const uint8_t *) mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (file->data == MAP_FAILED)
+	{
+		file->data = NULL;
+		return false;
+	}
+	file->size = file_stat.st_size;
+	stat_add(stat_bytes_mapped, file->size);
+#endif // _WIN32
+
+	return true;
+}
+
+/** Package File Functions */
+
+#define UDK_PACKAGE_TAG 0x9E2A83C1
+#define UDK_IMPORT_SIZE 0x1C
+#define UDK_CHUNK_INFO_SIZE 0x10
+#define UDK_COMPRESS_ZLIB 0x01
+#define UDK_COMPRESS_LZO 0x02
+#define UDK_COMPRESS_LZX 0x04
+
+/** Summary fields at the start of every package */
+struct UDKPackage_Summary
+{
+	uint32_t tag;
+	uint16_t file_version;
+	uint16_t licensee_version;
+	uint32_t header_size;
+	const char *folder_name; // points into the package data
+	int32_t folder_name_length;
+	uint32_t package_flags;
+	uint32_t name_count;
+	uint32_t name_offset;
+	uint32_t export_count;
+	uint32_t export_offset;
+	uint32_t import_count;
+	uint32_t import_offset;
+	uint32_t depends_offset;
+	uint32_t GUID[4];
+	uint32_t compression_flags;
+	uint32_t chunk_count;
+	const uint8_t *chunk_table; // points into the package data
+	uint64_t uncompressed_size; // end of the last compressed chunk
+};
+
+/** Read-only mapping of a package file; compressed packages are decompressed into a buffer on demand */
+struct UDKPackage_File
+{
+	struct Mapped_File file;
+	struct UDKPackage_Summary summary;
+	const uint8_t *data; // package contents at their uncompressed offsets; file.data unless compressed
+	size_t size; // bytes of data available
+	uint8_t *uncompressed;
+	bool *chunks_decompressed;
+
+	// built on demand by the export table functions
+	const char **names;
+	int32_t *name_lengths;
+	uint32_t *export_offsets; // offsets of the first exports_located + 1 entries
+	uint32_t exports_located;
+	uint32_t *export_index;
+	size_t export_index_mask;
+	uint32_t *export_name_next;
+};
+
+/** Zero-copy cursor over a package's name table */
+struct UDKName_View
+{
+	const uint8_t *position;
+	const uint8_t *end;
+	uint32_t remaining;
+};
+
+uint32_t read_uint32(const uint8_t *data)
+{
+	uint32_t result;
+
+	memcpy(&result, data, sizeof(result));
+	return result;
+}
+
+/** Bytes taken by a folder name of the given length; negative lengths are UTF-16 strings */
+size_t get_folder_name_size(int32_t folder_name_length)
+{
+	if (folder_name_length < 0)
+		return (size_t) -(int64_t) folder_name_length * 2;
+
+	return folder_name_length;
+}
+
+/** Decodes the summary from the first size bytes of a package; returns false if it doesn't fit */
+bool decode_package_summary(struct UDKPackage_Summary *summary, const uint8_t *data, size_t size)
+{
+	const uint8_t *itr;
+	size_t folder_name_size;
+
+	if (size < 0x10)
+		return false;
+
+	summary->tag = read_uint32(data);
+	memcpy(&summary->file_version, data + 0x04, sizeof(uint16_t));
+	memcpy(&summary->licensee_version, data + 0x06, sizeof(uint16_t));
+	summary->header_size = read_uint32(data + 0x08);
+	summary->folder_name_length = (int32_t) read_uint32(data + 0x0C);
+	summary->folder_name = (const char *) data + 0x10;
+	folder_name_size = get_folder_name_size(summary->folder_name_length);
+
+	if (size - 0x10 < folder_name_size + 0x40)
+		return false;
+
+	itr = data + 0x10 + folder_name_size;
+	summary->package_flags = read_uint32(itr);
+	summary->name_count = read_uint32(itr + 0x04);
+	summary->name_offset = read_uint32(itr + 0x08);
+	summary->export_count = read_uint32(itr + 0x0C);
+	summary->export_offset = read_uint32(itr + 0x10);
+	summary->import_count = read_uint32(itr + 0x14);
+	summary->import_offset = read_uint32(itr + 0x18);
+	summary->depends_offset = read_uint32(itr + 0x1C);
+	memcpy(summary->GUID, itr + 0x30, sizeof(summary->GUID));
+
+	return true;
+}
+
+#define PACKAGE_HEADER_READ_SIZE 512 // summary prefix holding the GUID unless the folder name is unusually long
+
+/** Decodes the GUID from the first size bytes of a package; if it lies past them, returns false with offset set to where it starts (0 if not even the folder name length fits) */
+bool decode_header_guid(const uint8_t *data, size_t size, uint32_t *GUID, uint64_t *offset)
+{
+	struct UDKPackage_Summary summary;
+
+	*offset = 0;
+	if (decode_package_summary(&summary, data, size))
+	{
+		memcpy(GUID, summary.GUID, sizeof(summary.GUID));
+		return true;
+	}
+
+	if (size >= 0x10)
+		*offset = 0x10 + (uint64_t) get_folder_name_size((int32_t) read_uint32(data + 0x0C)) + 0x30;
+	return false;
+}
+
+/**
+ * Reads the GUID of the package at path; on POSIX, path is relative to directory_fd. One read of the summary prefix
+ * suffices unless the folder name runs past it, which costs a second read at the GUID itself. Returns false if the
+ * file can't be opened; a file too short to hold a GUID gets a zero one.
+ */
+bool read_package_guid(int directory_fd, const char *path, uint32_t *GUID)
+{
+	uint8_t header[PACKAGE_HEADER_READ_SIZE];
+	uint64_t offset;
+	size_t length = 0;
+	size_t guid_length = 0;
+#if defined _WIN32
+	HANDLE handle;
+	OVERLAPPED overlapped;
+	DWORD count;
+
+	(void) directory_fd;
+	handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	stat_add(stat_syscalls, 1);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+	stat_add(stat_files_opened, 1);
+	stat_add(stat_syscalls, 2); // read, close
+
+	memset(&overlapped, 0, sizeof(overlapped));
+	if (ReadFile(handle, header, sizeof(header), &count, &overlapped))
+		length = count;
+#else
+	ssize_t count;
+	int fd = openat(directory_fd, path, O_RDONLY | O_CLOEXEC);
+
+	stat_add(stat_syscalls, 1);
+	if (fd < 0)
+		return false;
+	stat_add(stat_files_opened, 1);
+	stat_add(stat_syscalls, 2); // read, close
+
+	count = pread(fd, header, sizeof(header), 0);
+	if (count > 0)
+		length = count;
+#endif // _WIN32
+
+	stat_add(stat_bytes_read, length);
+	memset(GUID, 0, sizeof(uint32_t) * 4);
+	if (decode_header_guid(header, length, GUID, &offset) == false && length == sizeof(header))
+	{
+		// Long folder name; the GUID is past the prefix
+		stat_add(stat_syscalls, 1);
+#if defined _WIN32
+		overlapped.Offset = (DWORD) offset;
+		overlapped.OffsetHigh = (DWORD) (offset >> 32);
+		if (ReadFile(handle, header, sizeof(uint32_t) * 4, &count, &overlapped))
+			guid_length = count;
+#else
+		count = pread(fd, header, sizeof(uint32_t) * 4, (off_t) offset);
+		if (count > 0)
+			guid_length = count;
+#endif // _WIN32
+
+		stat_add(stat_bytes_read, guid_length);
+		if (guid_length == sizeof(uint32_t) * 4)
+			memcpy(GUID, header, sizeof(uint32_t) * 4);
+	}
+
+#if defined _WIN32
+	CloseHandle(handle);
+#else
+	close(fd);
+#endif // _WIN32
+
+	return true;
+}
+
+/** Decodes the compression flags and chunk table that follow the GUID and generations; returns false if they don't fit */
+bool decode_package_chunks(struct UDKPackage_Summary *summary, const uint8_t *data, size_t size)
+{
+	const uint8_t *itr = (const uint8_t *) summary->folder_name + get_folder_name_size(summary->folder_name_length) + 0x40;
+	const uint8_t *end = data + size;
+	uint32_t generation_count;
+	uint32_t index;
+	uint64_t chunk_end;
+
+	summary->compression_flags = 0;
+	summary->chunk_count = 0;
+	summary->chunk_table = NULL;
+	summary->uncompressed_size = 0;
+
+	// generations (export, name and net object counts), engine version, cooker version
+	if (end - itr < 4)
+		return false;
+	generation_count = read_uint32(itr);
+	if ((size_t) (end - itr - 4) / 12 < generation_count || (size_t) (end - itr - 4) - (size_t) generation_count * 12 < 16)
+		return false;
+	itr += 4 + (size_t) generation_count * 12 + 8;
+
+	summary->compression_flags = read_uint32(itr);
+	summary->chunk_count = read_uint32(itr + 4);
+	summary->chunk_table = itr + 8;
+	if ((size_t) (end - summary->chunk_table) / UDK_CHUNK_INFO_SIZE < summary->chunk_count)
+		return false;
+
+	// each chunk: uncompressed offset, uncompressed size, compressed offset, compressed size
+	for (index = 0; index != summary->chunk_count; ++index)
+	{
+		itr = summary->chunk_table + (size_t) index * UDK_CHUNK_INFO_SIZE;
+		chunk_end = (uint64_t) read_uint32(itr) + read_uint32(itr + 4);
+		if (chunk_end > summary->uncompressed_size)
+			summary->uncompressed_size = chunk_end;
+	}
+
+	return true;
+}
+
+/** LZO1X decompressor (the format written by lzo1x_1_compress); returns false on malformed input or if the output isn't exactly output_size bytes */
+bool lzo1x_decompress(const uint8_t *input, size_t input_size, uint8_t *output, size_t output_size)
+{
+	const uint8_t *ip = input;
+	const uint8_t *ip_end = input + input_size;
+	uint8_t *op = output;
+	uint8_t *op_end = output + output_size;
+	const uint8_t *match;
+	size_t distance;
+	size_t length;
+	size_t next;
+	size_t state = 0;
+
+#define LZO_NEED_INPUT(count) if ((size_t) (ip_end - ip) < (size_t) (count)) return false
+#define LZO_NEED_OUTPUT(count) if ((size_t) (op_end - op) < (size_t) (count)) return false
+#define LZO_EXTEND_LENGTH(length) while (true) { LZO_NEED_INPUT(1); if (*ip != 0) break; length += 255; ++ip; }
+
+	LZO_NEED_INPUT(3);
+	if (*ip > 17)
+	{
+		length = *ip++ - 17;
+		if (length < 4)
+		{
+			next = length;
+			goto copy_trailing_literals;
+		}
+		goto copy_literals;
+	}
+
+	while (true)
+	{
+		LZO_NEED_INPUT(1);
+		length = *ip++;
+		if (length < 16)
+		{
+			if (state == 0)
+			{
+				// literal run
+				if (length == 0)
+				{
+					LZO_EXTEND_LENGTH(length);
+					length += 15 + *ip++;
+				}
+				length += 3;
+copy_literals:
+				LZO_NEED_INPUT(length);
+				LZO_NEED_OUTPUT(length);
+				memcpy(op, ip, length);
+				op += length;
+				ip += length;
+				state = 4;
+				continue;
+			}
+
+			LZO_NEED_INPUT(1);
+			next = length & 3;
+			if (state != 4)
+			{
+				// two byte match within 1 KiB
+				distance = 1 + (length >> 2) + ((size_t) *ip++ << 2);
+				if (distance > (size_t) (op - output))
+					return false;
+				match = op - distance;
+				LZO_NEED_OUTPUT(2);
+				op[0] = match[0];
+				op[1] = match[1];
+				op += 2;
+				goto copy_trailing_literals;
+			}
+
+			// three byte match just past the short match range
+			distance = 1 + 0x800 + (length >> 2) + ((size_t) *ip++ << 2);
+			length = 3;
+		}
+		else if (length >= 64)
+		{
+			LZO_NEED_INPUT(1);
+			next = length & 3;
+			distance = 1 + ((length >> 2) & 7) + ((size_t) *ip++ << 3);
+			length = (length >> 5) + 1;
+		}
+		else if (length >= 32)
+		{
+			length = (length & 31) + 2;
+			if (length == 2)
+			{
+				LZO_EXTEND_LENGTH(length);
+				length += 31 + *ip++;
+			}
+			LZO_NEED_INPUT(2);
+			next = ip[0] | (size_t) ip[1] << 8;
+			ip += 2;
+			distance = 1 + (next >> 2);
+			next &= 3;
+		}
+		else
+		{
+			distance = (length & 8) << 11;
+			length = (length & 7) + 2;
+			if (length == 2)
+			{
+				LZO_EXTEND_LENGTH(length);
+				length += 7 + *ip++;
+			}
+			LZO_NEED_INPUT(2);
+			next = ip[0] | (size_t) ip[1] << 8;
+			ip += 2;
+			distance += next >> 2;
+			next &= 3;
+
+			// a zero distance marks the end of the stream
+			if (distance == 0)
+				return length == 3 && ip == ip_end && op == op_end;
+			distance += 0x4000;
+		}
+
+		if (distance > (size_t) (op - output))
+			return false;
+		match = op - distance;
+		LZO_NEED_OUTPUT(length);
+		while (length-- != 0)
+			*op++ = *match++; // may overlap
+
+copy_trailing_literals:
+		state = next;
+		LZO_NEED_INPUT(next + 1);
+		LZO_NEED_OUTPUT(next);
+		while (next-- != 0)
+			*op++ = *ip++;
+	}
+
+#undef LZO_NEED_INPUT
+#undef LZO_NEED_OUTPUT
+#undef LZO_EXTEND_LENGTH
+}
+
+struct Package_Block_Job
+{
+	const uint8_t *source;
+	size_t source_size;
+	uint8_t *destination;
+	size_t destination_size;
+	uint32_t compression_flags;
+	bool *failed;
+	struct Work_Group *group;
+};
+
+void decompress_package_block(struct Work_Pool *pool, size_t worker, void *data)
+{
+	struct Package_Block_Job *job = (struct Package_Block_Job *) data;
+	bool result = false;
+#if defined HAVE_ZLIB
+	uLongf length = (uLongf) job->destination_size;
+#endif // HAVE_ZLIB
+
+	(void) worker;
+
+	if (job->compression_flags & UDK_COMPRESS_LZO)
+		result = lzo1x_decompress(job->source, job->source_size, job->destination, job->destination_size);
+#if defined HAVE_ZLIB
+	else if (job->compression_flags & UDK_COMPRESS_ZLIB)
+		result = uncompress(job->destination, &length, job->source, (uLong) job->source_size) == Z_OK && length == job->destination_size;
+#endif // HAVE_ZLIB
+
+	if (result == false)
+		*job->failed = true;
+
+	work_group_done(pool, job->group);
+}
+
+/** Makes [start, end) of a compressed package available in package->data, decompressing the blocks of every chunk it overlaps in parallel; chunks are only ever decompressed once */
+bool read_package_range(struct UDKPackage_File *package, uint64_t start, uint64_t end)
+{
+	const struct UDKPackage_Summary *summary = &package->summary;
+	struct Work_Pool *pool;
+	struct Work_Group group = { 0 };
+	struct Package_Block_Job *jobs = NULL;
+	size_t job_count = 0;
+	size_t job_capacity = 0;
+	uint32_t *chunks_queued = NULL;
+	uint32_t queued_count = 0;
+	const uint8_t *chunk;
+	const uint8_t *blocks;
+	const uint8_t *source;
+	uint64_t chunk_start;
+	uint64_t chunk_size;
+	uint64_t compressed_offset;
+	uint64_t compressed_size;
+	uint64_t header_size;
+	uint32_t block_size;
+	uint32_t block_count;
+	uint32_t index;
+	uint32_t block;
+	uint64_t offset;
+	bool failed = false;
+
+	if (summary->chunk_count == 0)
+		return end <= package->size;
+
+	if (summary->compression_flags & UDK_COMPRESS_LZX)
+	{
+		puts("ERROR: LZX compressed packages are not supported.");
+		return false;
+	}
+#if !defined HAVE_ZLIB
+	if (summary->compression_flags & UDK_COMPRESS_ZLIB)
+	{
+		puts("ERROR: zlib compressed packages require a build with HAVE_ZLIB.");
+		return false;
+	}
+#endif // HAVE_ZLIB
+
+	if (end > summary->uncompressed_size || start > end)
+		return false;
+
+	// The buffer spans the uncompressed package, not the file, which can be longer or shorter than the last chunk
+	if (package->uncompressed == NULL)
+	{
+		package->chunks_decompressed = (bool *) calloc(summary->chunk_count, sizeof(bool));
+		package->uncompressed = (uint8_t *) calloc((size_t) summary->uncompressed_size + 1, sizeof(uint8_t));
+
+		// everything before the first chunk (the summary itself) is stored as-is
+		header_size = summary->uncompressed_size;
+		for (index = 0; index != summary->chunk_count; ++index)
+			if (read_uint32(summary->chunk_table + (size_t) index * UDK_CHUNK_INFO_SIZE) < header_size)
+				header_size = read_uint32(summary->chunk_table + (size_t) index * UDK_CHUNK_INFO_SIZE);
+		memcpy(package->uncompressed, package->file.data, (size_t) (header_size < package->file.size ? header_size : package->file.size));
+
+		package->data = package->uncompressed;
+		package->size = (size_t) summary->uncompressed_size;
+	}
+
+	chunks_queued = (uint32_t *) malloc(sizeof(uint32_t) * summary->chunk_count);
+	for (index = 0; index != summary->chunk_count; ++index)
+	{
+		chunk = summary->chunk_table + (size_t) index * UDK_CHUNK_INFO_SIZE;
+		chunk_start = read_uint32(chunk);
+		chunk_size = read_uint32(chunk + 4);
+		compressed_offset = read_uint32(chunk + 8);
+		compressed_size = read_uint32(chunk + 12);
+		if (chunk_start >= end || chunk_start + chunk_size <= start || package->chunks_decompressed[index])
+			continue;
+
+		// tag, block size, total compressed and uncompressed sizes, then a (compressed, uncompressed) size pair per block
+		if (compressed_offset > package->file.size || package->file.size - compressed_offset < compressed_size || compressed_size < 16)
+			goto fail;
+
+		chunk = package->file.data + compressed_offset;
+		block_size = read_uint32(chunk + 4);
+		if (read_uint32(chunk) != UDK_PACKAGE_TAG || block_size == 0 || read_uint32(chunk + 12) != chunk_size)
+			goto fail;
+
+		block_count = (uint32_t) ((chunk_size + block_size - 1) / block_size);
+		blocks = chunk + 16;
+		if ((compressed_size - 16) / 8 < block_count)
+			goto fail;
+
+		source = blocks + (size_t) block_count * 8;
+		offset = chunk_start;
+		for (block = 0; block != block_count; ++block)
+		{
+			if (job_count == job_capacity)
+			{
+				job_capacity = job_capacity == 0 ? 16 : job_capacity * 2;
+				jobs = (struct Package_Block_Job *) realloc(jobs, sizeof(struct Package_Block_Job) * job_capacity);
+			}
+
+			jobs[job_count].source = source;
+			jobs[job_count].source_size = read_uint32(blocks + (size_t) block * 8);
+			jobs[job_count].destination = package->uncompressed + offset;
+			jobs[job_count].destination_size = read_uint32(blocks + (size_t) block * 8 + 4);
+			jobs[job_count].compression_flags = summary->compression_flags;
+			jobs[job_count].failed = &failed;
+			jobs[job_count].group = &group;
+
+			if (jobs[job_count].source_size > (size_t) (chunk + compressed_size - source)
+				|| jobs[job_count].destination_size > chunk_start + chunk_size - offset)
+				goto fail;
+
+			source += jobs[job_count].source_size;
+			offset += jobs[job_count].destination_size;
+			++job_count;
+		}
+
+		if (offset != chunk_start + chunk_size)
+			goto fail;
+		chunks_queued[queued_count++] = index;
+	}
+
+	// Blocks are independent, so they all go to the pool at once
+	if (job_count != 0)
+	{
+		pool = get_work_pool();
+		for (index = 0; index != job_count; ++index)
+		{
+			work_group_add(pool, &group);
+			work_pool_push(pool, SIZE_MAX, decompress_package_block, &jobs[index]);
+		}
+		work_group_wait(pool, SIZE_MAX, &group);
+	}
+
+	// Only chunks whose every block inflated are skipped next time
+	if (failed == false)
+		for (index = 0; index != queued_count; ++index)
+			package->chunks_decompressed[chunks_queued[index]] = true;
+
+	free(chunks_queued);
+	free(jobs);
+	return failed == false;
+
+fail:
+	free(chunks_queued);
+	free(jobs);
+	return false;
+}
+
+void close_package_file(struct UDKPackage_File *package)
+{
+	free(package->uncompressed);
+	free(package->chunks_decompressed);
+	free(package->names);
+	free(package->name_lengths);
+	free(package->export_offsets);
+	free(package->export_index);
+	free(package->export_name_next);
+	package->uncompressed = NULL;
+	package->chunks_decompressed = NULL;
+	package->names = NULL;
+	package->name_lengths = NULL;
+	package->export_offsets = NULL;
+	package->export_index = NULL;
+	package->export_name_next = NULL;
+	unmap_file(&package->file);
+}
+
+/** Maps a package into memory and decodes its summary, decompressing the name and import tables if needed; returns false on failure or if the tables don't fit in the file */
+bool open_package_file(struct UDKPackage_File *package, const char *filename)
+{
+	uint64_t tables_start;
+	uint64_t tables_end;
+
+	package->uncompressed = NULL;
+	package->chunks_decompressed = NULL;
+	package->names = NULL;
+	package->name_lengths = NULL;
+	package->export_offsets = NULL;
+	package->exports_located = 0;
+	package->export_index = NULL;
+	package->export_index_mask = 0;
+	package->export_name_next = NULL;
+	if (map_file(&package->file, filename) == false)
+		return false;
+
+	package->data = package->file.data;
+	package->size = package->file.size;
+	if (decode_package_summary(&package->summary, package->file.data, package->file.size) == false
+		|| decode_package_chunks(&package->summary, package->file.data, package->file.size) == false)
+	{
+		close_package_file(package);
+		return false;
+	}
+
+	if (package->summary.chunk_count != 0)
+	{
+		// Tables are laid out names then imports; if not, take everything from the first table on
+		tables_start = package->summary.name_offset < package->summary.import_offset ? package->summary.name_offset : package->summary.import_offset;
+		tables_end = (uint64_t) package->summary.import_offset + (uint64_t) package->summary.import_count * UDK_IMPORT_SIZE;
+		if (package->summary.name_offset > package->summary.import_offset || tables_end > package->summary.uncompressed_size)
+			tables_end = package->summary.uncompressed_size;
+
+		if (read_package_range(package, tables_start, tables_end) == false)
+		{
+			close_package_file(package);
+			return false;
+		}
+	}
+
+	if (package->summary.name_offset > package->size
+		|| package->summary.import_offset > package->size
+		|| (package->size - package->summary.import_offset) / UDK_IMPORT_SIZE < package->summary.import_count)
+	{
+		close_package_file(package);
+		return false;
+	}
+
+	return true;
+}
+
+void get_name_view(const struct UDKPackage_File *package, struct UDKName_View *view)
+{
+	view->position = package->data + package->summary.name_offset;
+	view->end = package->data + package->size;
+	view->remaining = package->summary.name_count;
+}
+
+/** Returns the next name without copying it; length includes the null terminator and is negative for UTF-16 names */
+bool next_name(struct UDKName_View *view, const char **name, int32_t *length)
+{
+	size_t name_size;
+
+	if (view->remaining == 0 || view->end - view->position < 4)
+		return false;
+
+	*length = (int32_t) read_uint32(view->position);
+	if (*length < 0)
+		name_size = (size_t) -(int64_t) *length * 2;
+	else
+		name_size = *length;
+
+	// name, followed by 64-bit Object Flags
+	if ((size_t) (view->end - view->position) - 4 < name_size + 0x08)
+		return false;
+
+	*name = (const char *) view->position + 4;
+	view->position += 4 + name_size + 0x08;
+	--view->remaining;
+	return true;
+}
+
+/** Decodes one import table entry straight from the package data */
+void get_import(const struct UDKPackage_File *package, uint32_t index, struct UDKImport *import)
+{
+	const uint8_t *entry = package->data + package->summary.import_offset + (size_t) index * UDK_IMPORT_SIZE;
+
+	// "Name indexes work the same way as #Index but since Unreal Engine 3 indexes referencing a name, have a another Int32 followed after the index."
+	// Source: http://eliotvu.com/page/unreal-package-file-format
+	import->package_name_index = read_uint32(entry);
+	import->class_name_index = read_uint32(entry + 0x08);
+	import->package_reference = (int32_t) read_uint32(entry + 0x10);
+	import->object_name_index = read_uint32(entry + 0x14);
+}
+
+/** Name Table Functions */
+
+const char *get_name(uint32_t index)
+{
+	return name_table + name_table_offsets[index];
+}
+
+/** Case-insensitive FNV-1a; name_end may be NULL for null-terminated names */
+uint32_t name_hash(const char *name, const char *name_end)
+{
+	uint32_t result = 2166136261U;
+
+	while (name != name_end && *name != '\0')
+	{
+		result ^= (uint8_t) toupper(*name);
+		result *= 16777619U;
+		++name;
+	}
+
+	return result;
+}
+
+void build_name_index()
+{
+	uint32_t capacity = 16;
+	uint32_t index;
+	uint32_t hash;
+	uint32_t slot;
+
+	while (capacity < name_table_size * 2)
+		capacity *= 2;
+
+	if (name_index != NULL)
+		free(name_index);
+	name_index = (struct UDKName_Slot *) malloc(sizeof(struct UDKName_Slot) * capacity);
+	name_index_mask = capacity - 1;
+
+	for (slot = 0; slot != capacity; ++slot)
+		name_index[slot].index = INVALID_NAME;
+
+	// Insert in table order, so duplicates resolve to the lowest index
+	for (index = 0; index != name_table_size; ++index)
+	{
+		hash = name_hash(get_name(index), NULL);
+		slot = hash & name_index_mask;
+		while (name_index[slot].index != INVALID_NAME)
+			slot = (slot + 1) & name_index_mask;
+
+		name_index[slot].hash = hash;
+		name_index[slot].index = index;
+	}
+}
+
+void free_name_table()
+{
+	free(name_table);
+	free(name_table_offsets);
+	free(name_index);
+
+	name_table = NULL;
+	name_table_offsets = NULL;
+	name_table_size = 0;
+	name_index = NULL;
+	name_index_mask = 0;
+}
+
+bool read_name_table(const struct UDKPackage_File *package)
+{
+	struct UDKName_View view;
+	const char *name;
+	int32_t length;
+	int32_t tmp;
+	size_t arena_size = 0;
+	uint32_t index;
+	char *itr;
+
+	free_name_table();
+
+	// size the arena up front from the mapped names; lengths include the null terminator, negative lengths are UTF-16
+	get_name_view(package, &view);
+	while (next_name(&view, &name, &length))
+	{
+		arena_size += (length < 0 ? -length : length == 0 ? 1 : length);
+		++name_table_size;
+	}
+
+	name_table = (char *) malloc(sizeof(char) * (arena_size + 1));
+	name_table_offsets = (uint32_t *) malloc(sizeof(uint32_t) * (name_table_size + 1));
+
+	// copy names into the arena
+	itr = name_table;
+	get_name_view(package, &view);
+	for (index = 0; index != name_table_size; ++index)
+	{
+		next_name(&view, &name, &length);
+		name_table_offsets[index] = (uint32_t) (itr - name_table);
+
+		if (length > 0)
+		{
+			memcpy(itr, name, length - 1);
+			itr += length - 1;
+		}
+		else if (length < 0)
+		{
+			// narrow UTF-16 names; package names are ASCII
+			for (tmp = 0; tmp != -length - 1; ++tmp)
+				*itr++ = name[tmp * 2];
+		}
+		*itr++ = '\0';
+	}
+
+	build_name_index();
+	return name_table_size == package->summary.name_count;
+}
+
+void print_name_table(struct Writer *out)
+{
+	size_t index;
+
+	if (output_format == format_binary)
+		writer_put_dump_header(out, NAME_TABLE_MAGIC, (uint32_t) name_table_size);
+
+	for (index = 0; index != name_table_size; ++index)
+	{
+		switch (output_format)
+		{
+		case format_text:
+			writer_put_decimal(out, index);
+			writer_write(out, ": ", 2);
+			writer_puts(out, get_name(index));
+			writer_write(out, "\r\n", 2);
+			break;
+		case format_json:
+			writer_write(out, "{\"index\":", 9);
+			writer_put_decimal(out, index);
+			writer_write(out, ",\"name\":", 8);
+			writer_put_json_string(out, get_name(index));
+			writer_write(out, "}\n", 2);
+			break;
+		case format_binary:
+			writer_put_binary_string(out, get_name(index));
+			break;
+		}
+	}
+}
+
+/** Exact (case-sensitive) lookup */
+uint32_t find_name(const char *name)
+{
+	uint32_t hash = name_hash(name, NULL);
+	uint32_t slot;
+
+	if (name_index == NULL)
+		return INVALID_NAME;
+
+	for (slot = hash & name_index_mask; name_index[slot].index != INVALID_NAME; slot = (slot + 1) & name_index_mask)
+		if (name_index[slot].hash == hash && strcmp(name, get_name(name_index[slot].index)) == 0)
+			return name_index[slot].index;
+
+	return INVALID_NAME;
+}
+
+/** Case-insensitive lookup of [name_start, name_end), as UE3 compares names */
+uint32_t find_name_2ptr(const char *name_start, const char *name_end)
+{
+	uint32_t hash = name_hash(name_start, name_end);
+	uint32_t slot;
+
+	if (name_index == NULL)
+		return INVALID_NAME;
+
+	for (slot = hash & name_index_mask; name_index[slot].index != INVALID_NAME; slot = (slot + 1) & name_index_mask)
+		if (name_index[slot].hash == hash && streql_2ptr(name_start, name_end, get_name(name_index[slot].index)))
+			return name_index[slot].index;
+
+	return INVALID_NAME;
+}
+
+uint32_t name_from_filename(const char *filename, size_t filename_length)
+{
+	const char *start_name = NULL;
+	const char *end_name = NULL;
+
+	filename += filename_length;
+	while (filename_length != 0)
+	{
+		--filename;
+
+		if (*filename == '.' && end_name == NULL)
+			end_name = filename;
+
+		if (*filename == '\\' || *filename == '/')
+		{
+			start_name = ++filename;
+			break;
+		}
+
+		--filename_length;
+	}
+
+	if (start_name == NULL)
+		start_name = filename;
+
+	if (end_name == NULL)
+		return find_name(start_name);
+
+	return find_name_2ptr(start_name, end_name);
+}
+
+/** Import Table Functions */
+
+bool read_import_table(const struct UDKPackage_File *package)
+{
+	uint32_t tmp;
+
+	// allocate array of UDKImport objects
+	if (import_table != NULL)
+		free(import_table);
+	import_table_size = package->summary.import_count;
+	import_table = (struct UDKImport *) malloc(sizeof(struct UDKImport) * import_table_size);
+	packages_imported = 0;
+
+	// read import table
+	for (tmp = 0; tmp != import_table_size; ++tmp)
+	{
+		get_import(package, tmp, &import_table[tmp]);
+
+		if (import_table[tmp].package_name_index >= name_table_size
+			|| import_table[tmp].class_name_index >= name_table_size
+			|| import_table[tmp].object_name_index >= name_table_size)
+		{
+			import_table_size = tmp;
+			return false;
+		}
+
+		if (import_table[tmp].package_reference == 0)
+			++packages_imported;
+	}
+
+	return true;
+}
+
+void print_import_table(struct Writer *out)
+{
+	size_t index;
+	struct UDKImport *itr = import_table;
+
+	if (output_format == format_binary)
+		writer_put_dump_header(out, IMPORT_TABLE_MAGIC, import_table_size);
+
+	for (index = 0; index != import_table_size; ++index, ++itr)
+	{
+		switch (output_format)
+		{
+		case format_text:
+			writer_put_decimal(out, index);
+			writer_write(out, " | Package: ", 12);
+			writer_puts(out, get_name(itr->package_name_index));
+			writer_write(out, " | Class: ", 10);
+			writer_puts(out, get_name(itr->class_name_index));
+			writer_write(out, " | Object: ", 11);
+			writer_puts(out, get_name(itr->object_name_index));
+			writer_write(out, " | Reference: ", 14);
+			writer_put_decimal(out, itr->package_reference);
+			writer_write(out, "\r\n", 2);
+			break;
+		case format_json:
+			writer_write(out, "{\"index\":", 9);
+			writer_put_decimal(out, index);
+			writer_write(out, ",\"package\":", 11);
+			writer_put_json_string(out, get_name(itr->package_name_index));
+			writer_write(out, ",\"class\":", 9);
+			writer_put_json_string(out, get_name(itr->class_name_index));
+			writer_write(out, ",\"object\":", 10);
+			writer_put_json_string(out, get_name(itr->object_name_index));
+			writer_write(out, ",\"reference\":", 13);
+			writer_put_decimal(out, itr->package_reference);
+			writer_write(out, "}\n", 2);
+			break;
+		case format_binary:
+			writer_put_binary_string(out, get_name(itr->package_name_index));
+			writer_put_binary_string(out, get_name(itr->class_name_index));
+			writer_put_binary_string(out, get_name(itr->object_name_index));
+			writer_put_uint32(out, (uint32_t) itr->package_reference);
+			break;
+		}
+	}
+}
+
+/** Export Table Functions */
+
+/**
+ * Exports are variable-length (each carries its net object list), so they can't be indexed directly. get_export locates
+ * entries on demand, remembering every offset it passes, and find_export builds a name index over the whole table the
+ * first time it is called. All of this state belongs to the UDKPackage_File, which must not be shared between threads.
+ */
+
+#define UDK_EXPORT_MIN_SIZE 0x44
+
+struct UDKExport
+{
+	int32_t class_index; // object reference: < 0 is an import, > 0 an export, 0 is UClass
+	int32_t super_index;
+	int32_t outer_index;
+	uint32_t object_name_index;
+	int32_t archetype_index;
+	uint64_t object_flags;
+	uint32_t serial_size;
+	uint32_t serial_offset;
+	uint32_t export_flags;
+};
+
+/** Returns a name from a package's own name table (not null-terminated UTF-16 names); indexes the name table on first use */
+bool get_package_file_name(struct UDKPackage_File *package, uint32_t index, const char **name, int32_t *length)
+{
+	struct UDKName_View view;
+	uint32_t count;
+
+	if (index >= package->summary.name_count)
+		return false;
+
+	if (package->names == NULL)
+	{
+		package->names = (const char **) calloc(package->summary.name_count + 1, sizeof(const char *));
+		package->name_lengths = (int32_t *) calloc(package->summary.name_count + 1, sizeof(int32_t));
+		get_name_view(package, &view);
+		for (count = 0; count != package->summary.name_count && next_name(&view, &package->names[count], &package->name_lengths[count]); ++count);
+	}
+
+	*name = package->names[index];
+	*length = package->name_lengths[index];
+	return *name != NULL && *length > 0 && (*name)[*length - 1] == '\0';
+}
+
+/** Finds the offsets of the first count exports, continuing from wherever the last call stopped */
+bool locate_exports(struct UDKPackage_File *package, uint32_t count)
+{
+	const struct UDKPackage_Summary *summary = &package->summary;
+	uint64_t table_end;
+	uint64_t offset;
+	uint32_t net_object_count;
+
+	if (count > summary->export_count)
+		return false;
+
+	if (package->export_offsets == NULL)
+	{
+		// in compressed packages the export table runs up to the depends map, if it follows
+		table_end = summary->depends_offset > summary->export_offset ? summary->depends_offset : summary->uncompressed_size;
+		if (summary->chunk_count != 0 && read_package_range(package, summary->export_offset, table_end) == false)
+			return false;
+
+		package->export_offsets = (uint32_t *) malloc(sizeof(uint32_t) * (summary->export_count + 1));
+		package->export_offsets[0] = summary->export_offset;
+	}
+
+	while (package->exports_located < count)
+	{
+		offset = package->export_offsets[package->exports_located];
+		if (offset > package->size || package->size - offset < UDK_EXPORT_MIN_SIZE)
+			return false;
+
+		net_object_count = read_uint32(package->data + offset + 0x2C);
+		if ((package->size - offset - UDK_EXPORT_MIN_SIZE) / 4 < net_object_count)
+			return false;
+
+		offset += UDK_EXPORT_MIN_SIZE + (uint64_t) net_object_count * 4;
+		if (offset > UINT32_MAX)
+			return false;
+
+		package->export_offsets[++package->exports_located] = (uint32_t) offset;
+	}
+
+	return true;
+}
+
+/** Decodes one export table entry from the package data; returns false if it's out of range or malformed */
+bool get_export(struct UDKPackage_File *package, uint32_t index, struct UDKExport *export)
+{
+	const uint8_t *entry;
+
+	if (index >= package->summary.export_count || locate_exports(package, index + 1) == false)
+		return false;
+
+	entry = package->data + package->export_offsets[index];
+	export->class_index = (int32_t) read_uint32(entry);
+	export->super_index = (int32_t) read_uint32(entry + 0x04);
+	export->outer_index = (int32_t) read_uint32(entry + 0x08);
+	export->object_name_index = read_uint32(entry + 0x0C);
+	export->archetype_index = (int32_t) read_uint32(entry + 0x14);
+	memcpy(&export->object_flags, entry + 0x18, sizeof(export->object_flags));
+	export->serial_size = read_uint32(entry + 0x20);
+	export->serial_offset = read_uint32(entry + 0x24);
+	export->export_flags = read_uint32(entry + 0x28);
+	return true;
+}
+
+/** Builds the name index: slots hold the first export with a name, and export_name_next chains the rest */
+bool build_export_index(struct UDKPackage_File *package)
+{
+	struct UDKExport export;
+	const char *name;
+	const char *slot_name;
+	int32_t length;
+	int32_t slot_length;
+	uint32_t index;
+	size_t slot;
+
+	if (locate_exports(package, package->summary.export_count) == false)
+		return false;
+
+	for (package->export_index_mask = 63; package->export_index_mask < (size_t) package->summary.export_count * 2; package->export_index_mask = package->export_index_mask * 2 + 1);
+	package->export_index = (uint32_t *) malloc(sizeof(uint32_t) * (package->export_index_mask + 1));
+	package->export_name_next = (uint32_t *) malloc(sizeof(uint32_t) * (package->summary.export_count + 1));
+	memset(package->export_index, 0xFF, sizeof(uint32_t) * (package->export_index_mask + 1));
+
+	// insert in reverse so each chain runs in table order
+	for (index = package->summary.export_count; index-- != 0;)
+	{
+		package->export_name_next[index] = INVALID_NAME;
+		if (get_export(package, index, &export) == false || get_package_file_name(package, export.object_name_index, &name, &length) == false)
+			continue;
+
+		for (slot = name_hash(name, NULL) & package->export_index_mask; package->export_index[slot] != INVALID_NAME; slot = (slot + 1) & package->export_index_mask)
+		{
+			// indexed exports always have a valid name
+			get_export(package, package->export_index[slot], &export);
+			get_package_file_name(package, export.object_name_index, &slot_name, &slot_length);
+			if (strcmpi(name, slot_name) == 0)
+			{
+				package->export_name_next[index] = package->export_index[slot];
+				break;
+			}
+		}
+		package->export_index[slot] = index;
+	}
+
+	return true;
+}
+
+/** Returns the first export named [name, name_end) (case-insensitive), or INVALID_NAME; further matches follow via next_export_with_name */
+uint32_t find_export(struct UDKPackage_File *package, const char *name, const char *name_end)
+{
+	struct UDKExport export;
+	const char *slot_name;
+	int32_t slot_length;
+	size_t slot;
+
+	if (package->export_index == NULL && build_export_index(package) == false)
+		return INVALID_NAME;
+
+	for (slot = name_hash(name, name_end) & package->export_index_mask; package->export_index[slot] != INVALID_NAME; slot = (slot + 1) & package->export_index_mask)
+	{
+		get_export(package, package->export_index[slot], &export);
+		get_package_file_name(package, export.object_name_index, &slot_name, &slot_length);
+		if (streql_2ptr(name, name_end, slot_name))
+			return package->export_index[slot];
+	}
+
+	return INVALID_NAME;
+}
+
+uint32_t next_export_with_name(const struct UDKPackage_File *package, uint32_t index)
+{
+	return package->export_name_next[index];
+}
+
+/** Name of the object a class/outer/archetype reference points at */
+const char *get_object_reference_name(struct UDKPackage_File *package, int32_t reference)
+{
+	struct UDKImport import;
+	struct UDKExport export;
+	const char *name;
+	int32_t length;
+
+	if (reference == 0)
+		return "Class";
+
+	if (reference < 0)
+	{
+		if ((uint32_t) -(int64_t) reference > package->summary.import_count)
+			return "?";
+		get_import(package, (uint32_t) (-(int64_t) reference - 1), &import);
+		return get_package_file_name(package, import.object_name_index, &name, &length) ? name : "?";
+	}
+
+	if (get_export(package, (uint32_t) reference - 1, &export) == false)
+		return "?";
+	return get_package_file_name(package, export.object_name_index, &name, &length) ? name : "?";
+}
+
+bool print_export_table(FILE *out, struct UDKPackage_File *package)
+{
+	struct UDKExport export;
+	const char *name;
+	int32_t length;
+	uint32_t index;
+
+	for (index = 0; index != package->summary.export_count; ++index)
+	{
+		if (get_export(package, index, &export) == false)
+			return false;
+
+		fprintf(out, "%u | Class: %s | Outer: %s | Object: %s | Offset: %u | Size: %u\r\n", index,
+			get_object_reference_name(package, export.class_index),
+			export.outer_index == 0 ? "None" : get_object_reference_name(package, export.outer_index),
+			get_package_file_name(package, export.object_name_index, &name, &length) ? name : "?",
+			export.serial_offset, export.serial_size);
+	}
+
+	return true;
+}
+
+/** Against list */
+
+uint32_t guid_hash(const uint32_t *GUID)
+{
+	uint64_t result = ((uint64_t) GUID[0] << 32 | GUID[1]) ^ ((uint64_t) GUID[2] << 32 | GUID[3]) * 0x9E3779B97F4A7C15ULL;
+
+	result ^= result >> 29;
+	result *= 0xBF58476D1CE4E5B9ULL;
+	return (uint32_t) (result ^ (result >> 32));
+}
+
+/**
+ * Against list file layout (little-endian):
+ *	Against_List_Header
+ *	GUIDs: count * 16 bytes, sorted in memcmp order
+ *	Names: count * uint32 string pool offsets (AGAINST_LIST_HAS_NAMES)
+ *	String pool: null-terminated package names (AGAINST_LIST_HAS_NAMES)
+ *	Index: index_capacity * uint32 GUID indices, UINT32_MAX if empty, probed linearly from guid_hash (AGAINST_LIST_HAS_INDEX)
+ * Every section is 4-byte aligned. Legacy files are a uint32 count followed by count GUIDs.
+ */
+
+#define AGAINST_LIST_MAGIC 0x4C415852 // "RXAL"
+#define AGAINST_LIST_VERSION 1
+#define AGAINST_LIST_HAS_NAMES 0x01
+#define AGAINST_LIST_HAS_INDEX 0x02
+
+struct Against_List_Header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t flags;
+	uint32_t count;
+	uint32_t GUIDs_offset;
+	uint32_t names_offset;
+	uint32_t string_pool_offset;
+	uint32_t string_pool_size;
+	uint32_t index_offset;
+	uint32_t index_capacity;
+	uint32_t reserved[2];
+};
+
+struct Against_List_Entry
+{
+	uint32_t GUID[4];
+	const char *name;
+};
+
+struct Mapped_File against_list_file; // backs the against list when loaded from a file
+bool against_index_allocated = false;
+
+void free_against_list()
+{
+	if (against_list_file.data != NULL)
+		unmap_file(&against_list_file);
+	else
+	{
+		free(against_list);
+		free(against_list_names);
+		free(against_list_string_pool);
+	}
+
+	if (against_index_allocated)
+		free(against_index);
+
+	against_list_size = 0;
+	against_list = NULL;
+	against_list_names = NULL;
+	against_list_string_pool = NULL;
+	against_list_string_pool_size = 0;
+	against_index = NULL;
+	against_index_mask = 0;
+	against_index_allocated = false;
+}
+
+void build_against_index()
+{
+	uint32_t capacity = 16;
+	uint32_t index;
+	uint32_t slot;
+
+	while (capacity <= against_list_size * 2)
+		capacity *= 2;
+
+	if (against_index_allocated)
+		free(against_index);
+	against_index = (uint32_t *) malloc(sizeof(uint32_t) * capacity);
+	against_index_mask = capacity - 1;
+	against_index_allocated = true;
+	memset(against_index, 0xFF, sizeof(uint32_t) * capacity);
+
+	for (index = 0; index != against_list_size; ++index)
+	{
+		slot = guid_hash(against_list + index * 4) & against_index_mask;
+		while (against_index[slot] != UINT32_MAX)
+			slot = (slot + 1) & against_index_mask;
+
+		against_index[slot] = index;
+	}
+}
+
+bool section_fits(const struct Mapped_File *file, uint32_t offset, uint64_t size)
+{
+	return offset % 4 == 0 && offset <= file->size && size <= file->size - offset;
+}
+
+/** True if every name offset is inside the string pool and the pool ends in a terminator, so no name runs off its end */
+bool names_fit(const uint32_t *names, uint32_t count, const char *string_pool, uint32_t string_pool_size)
+{
+	uint32_t index;
+
+	if (count != 0 && (string_pool_size == 0 || string_pool[string_pool_size - 1] != '\0'))
+		return false;
+
+	for (index = 0; index != count; ++index)
+		if (names[index] >= string_pool_size)
+			return false;
+
+	return true;
+}
+
+/** Maps an against list in place; the legacy format is accepted as well */
+bool load_against_list(const char *filename)
+{
+	const struct Against_List_Header *header;
+	uint32_t count;
+
+	free_against_list();
+	if (map_file(&against_list_file, filename) == false)
+		return false;
+
+	header = (const struct Against_List_Header *) against_list_file.data;
+	if (against_list_file.size >= sizeof(struct Against_List_Header) && header->magic == AGAINST_LIST_MAGIC)
+	{
+		if (header->version != AGAINST_LIST_VERSION
+			|| section_fits(&against_list_file, header->GUIDs_offset, (uint64_t) header->count * 16) == false
+			|| ((header->flags & AGAINST_LIST_HAS_NAMES)
+				&& (section_fits(&against_list_file, header->names_offset, (uint64_t) header->count * 4) == false
+					|| header->string_pool_offset > against_list_file.size
+					|| header->string_pool_size > against_list_file.size - header->string_pool_offset
+					|| names_fit((const uint32_t *) (against_list_file.data + header->names_offset), header->count,
+						(const char *) (against_list_file.data + header->string_pool_offset), header->string_pool_size) == false))
+			|| ((header->flags & AGAINST_LIST_HAS_INDEX)
+				&& (header->index_capacity <= header->count
+					|| (header->index_capacity & (header->index_capacity - 1)) != 0
+					|| section_fits(&against_list_file, header->index_offset, (uint64_t) header->index_capacity * 4) == false)))
+		{
+			unmap_file(&against_list_file);
+			return false;
+		}
+
+		against_list_size = header->count;
+		against_list = (uint32_t *) (against_list_file.data + header->GUIDs_offset);
+
+		if (header->flags & AGAINST_LIST_HAS_NAMES)
+		{
+			against_list_names = (uint32_t *) (against_list_file.data + header->names_offset);
+			against_list_string_pool = (char *) (against_list_file.data + header->string_pool_offset);
+			against_list_string_pool_size = header->string_pool_size;
+		}
+
+		if (header->flags & AGAINST_LIST_HAS_INDEX)
+		{
+			against_index = (uint32_t *) (against_list_file.data + header->index_offset);
+			against_index_mask = header->index_capacity - 1;
+		}
+		else
+			build_against_index();
+
+		return true;
+	}
+
+	// Legacy: count followed by raw GUIDs
+	if (against_list_file.size < sizeof(count))
+	{
+		unmap_file(&against_list_file);
+		return false;
+	}
+
+	memcpy(&count, against_list_file.data, sizeof(count));
+	if ((against_list_file.size - sizeof(count)) / 16 < count)
+	{
+		unmap_file(&against_list_file);
+		return false;
+	}
+
+	against_list_size = count;
+	against_list = (uint32_t *) (against_list_file.data + sizeof(count));
+	build_against_index();
+	return true;
+}
+
+/** Orders by GUID, then name, so the list doesn't depend on the order packages were found in */
+int compare_against_list_entries(const void *lhs, const void *rhs)
+{
+	int result = memcmp(((const struct Against_List_Entry *) lhs)->GUID, ((const struct Against_List_Entry *) rhs)->GUID, sizeof(uint32_t) * 4);
+
+	if (result == 0)
+		result = strcmp(((const struct Against_List_Entry *) lhs)->name, ((const struct Against_List_Entry *) rhs)->name);
+	return result;
+}
+
+void build_against_list()
+{
+	struct Against_List_Entry *entries;
+	size_t count = 0;
+	size_t index;
+	size_t length;
+	size_t string_pool_size = 0;
+
+	free_against_list();
+
+	// collect, sort and deduplicate (the same package may be installed in several directories)
+	entries = (struct Against_List_Entry *) malloc(sizeof(struct Against_List_Entry) * (game_package_table_size + 1));
+	for (index = 0; index != game_package_table_size; ++index)
+	{
+		memcpy(entries[index].GUID, game_package_table[index].GUID, sizeof(entries[index].GUID));
+		entries[index].name = game_package_table[index].name;
+	}
+	qsort(entries, game_package_table_size, sizeof(struct Against_List_Entry), compare_against_list_entries);
+
+	for (index = 0; index != game_package_table_size; ++index)
+	{
+		if (count != 0 && memcmp(entries[count - 1].GUID, entries[index].GUID, sizeof(uint32_t) * 4) == 0)
+			continue;
+
+		entries[count++] = entries[index];
+		string_pool_size += strlen(entries[index].name) + 1;
+	}
+
+	against_list_size = (uint32_t) count;
+	against_list = (uint32_t *) malloc(sizeof(uint32_t) * 4 * (count + 1));
+	against_list_names = (uint32_t *) malloc(sizeof(uint32_t) * (count + 1));
+	against_list_string_pool = (char *) malloc(sizeof(char) * (string_pool_size + 1));
+	against_list_string_pool_size = 0;
+
+	for (index = 0; index != count; ++index)
+	{
+		memcpy(against_list + index * 4, entries[index].GUID, sizeof(uint32_t) * 4);
+
+		length = strlen(entries[index].name) + 1;
+		against_list_names[index] = against_list_string_pool_size;
+		memcpy(against_list_string_pool + against_list_string_pool_size, entries[index].name, length);
+		against_list_string_pool_size += (uint32_t) length;
+	}
+
+	free(entries);
+	build_against_index();
+}
+
+void write_against_list(FILE *against_file)
+{
+	struct Against_List_Header header;
+	static const uint8_t padding[4] = { 0, 0, 0, 0 };
+	uint32_t string_pool_padding = 0;
+
+	if (against_index == NULL)
+		build_against_index();
+
+	memset(&header, 0, sizeof(header));
+	header.magic = AGAINST_LIST_MAGIC;
+	header.version = AGAINST_LIST_VERSION;
+	header.flags = AGAINST_LIST_HAS_INDEX;
+	header.count = against_list_size;
+	header.GUIDs_offset = sizeof(header);
+	header.names_offset = header.GUIDs_offset + against_list_size * 16;
+	header.string_pool_offset = header.names_offset;
+	header.index_offset = header.names_offset;
+	header.index_capacity = against_index_mask + 1;
+
+	if (against_list_names != NULL)
+	{
+		header.flags |= AGAINST_LIST_HAS_NAMES;
+		header.string_pool_offset = header.names_offset + against_list_size * 4;
+		header.string_pool_size = against_list_string_pool_size;
+		string_pool_padding = (4 - against_list_string_pool_size % 4) % 4;
+		header.index_offset = header.string_pool_offset + against_list_string_pool_size + string_pool_padding;
+	}
+
+	fwrite(&header, sizeof(header), 1, against_file);
+	fwrite(against_list, sizeof(uint32_t) * 4, against_list_size, against_file);
+	if (against_list_names != NULL)
+	{
+		fwrite(against_list_names, sizeof(uint32_t), against_list_size, against_file);
+		fwrite(against_list_string_pool, sizeof(char), against_list_string_pool_size, against_file);
+		fwrite(padding, sizeof(uint8_t), string_pool_padding, against_file);
+	}
+	fwrite(against_index, sizeof(uint32_t), header.index_capacity, against_file);
+}
+
+void write_legacy_against_list(FILE *against_file)
+{
+	fwrite(&against_list_size, sizeof(against_list_size), 1, against_file);
+	fwrite(against_list, sizeof(uint32_t) * 4, against_list_size, against_file);
+}
+
+bool is_in_against_list(const uint32_t *GUID)
+{
+	uint32_t slot;
+	uint32_t probes;
+
+	if (against_index == NULL)
+		return false;
+
+	// bounded, since a mapped index can't be trusted to contain an empty slot
+	slot = guid_hash(GUID) & against_index_mask;
+	for (probes = 0; probes <= against_index_mask && against_index[slot] < against_list_size; ++probes, slot = (slot + 1) & against_index_mask)
+		if (memcmp(GUID, against_list + against_index[slot] * 4, sizeof(uint32_t) * 4) == 0)
+			return true;
+
+	return false;
+}
+
+/** Package Cache */
+
+/**
+ * Package cache file layout (native byte order; not portable between platforms):
+ *	uint32 magic, uint32 version, uint32 count
+ *	count * { uint64 size, int64 modification time, uint32 GUID[4], uint32 path length, path }
+ */
+
+#define PACKAGE_CACHE_MAGIC 0x43505852 // "RXPC"
+#define PACKAGE_CACHE_VERSION 1
+
+struct Package_Cache_Entry
+{
+	char *path;
+	uint64_t size;
+	int64_t mtime;
+	uint32_t GUID[4];
+	bool seen; // stat data was confirmed during this run
+};
+
+struct Package_Cache_Entry *package_cache = NULL;
+size_t package_cache_size = 0;
+size_t package_cache_capacity = 0;
+size_t *package_cache_index = NULL; // open addressing; SIZE_MAX if empty
+size_t package_cache_index_mask = 0;
+bool package_cache_enabled = false;
+bool package_cache_dirty = false;
+mutex_t package_cache_lock;
+
+/** Size and modification time of a file; on POSIX, path is relative to directory_fd */
+bool stat_file(int directory_fd, const char *path, uint64_t *size, int64_t *mtime)
+{
+#if defined _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA file_data;
+
+	(void) directory_fd;
+	stat_add(stat_syscalls, 1);
+	if (GetFileAttributesEx(path, GetFileExInfoStandard, &file_data) == FALSE)
+		return false;
+
+	*size = (uint64_t) file_data.nFileSizeHigh << 32 | file_data.nFileSizeLow;
+	*mtime = (int64_t) ((uint64_t) file_data.ftLastWriteTime.dwHighDateTime << 32 | file_data.ftLastWriteTime.dwLowDateTime);
+#else
+	struct stat file_stat;
+
+	stat_add(stat_syscalls, 1);
+	if (fstatat(directory_fd, path, &file_stat, 0) != 0)
+		return false;
+
+	*size = file_stat.st_size;
+#if defined __linux__
+	*mtime = (int64_t) file_stat.st_mtim.tv_sec * 1000000000 + file_stat.st_mtim.tv_nsec;
+#else
+	*mtime = (int64_t) file_stat.st_mtime * 1000000000;
+#endif // __linux__
+#endif // _WIN32
+
+	return true;
+}
+
+bool stat_crawl_entry(const struct Crawl_Entry *entry, const char *path, uint64_t *size, int64_t *mtime)
+{
+#if defined _WIN32
+	return stat_file(0, path, size, mtime);
+#else
+	(void) path;
+	return stat_file(entry->directory_fd, entry->filename, size, mtime);
+#endif // _WIN32
+}
+
+void index_package_cache_entry(size_t entry)
+{
+	size_t slot = name_hash(package_cache[entry].path, NULL) & package_cache_index_mask;
+
+	while (package_cache_index[slot] != SIZE_MAX)
+		slot = (slot + 1) & package_cache_index_mask;
+
+	package_cache_index[slot] = entry;
+}
+
+/** Adds an entry, growing the table and index as needed; caller holds package_cache_lock once the cache is in use */
+struct Package_Cache_Entry *add_package_cache_entry(char *path)
+{
+	size_t index;
+
+	if (package_cache_size == package_cache_capacity)
+	{
+		package_cache_capacity = package_cache_capacity == 0 ? 256 : package_cache_capacity * 2;
+		package_cache = (struct Package_Cache_Entry *) realloc(package_cache, sizeof(struct Package_Cache_Entry) * package_cache_capacity);
+
+		free(package_cache_index);
+		package_cache_index = (size_t *) malloc(sizeof(size_t) * package_cache_capacity * 2);
+		package_cache_index_mask = package_cache_capacity * 2 - 1;
+		memset(package_cache_index, 0xFF, sizeof(size_t) * package_cache_capacity * 2);
+
+		for (index = 0; index != package_cache_size; ++index)
+			index_package_cache_entry(index);
+	}
+
+	package_cache[package_cache_size].path = path;
+	package_cache[package_cache_size].seen = false;
+	index_package_cache_entry(package_cache_size);
+	return &package_cache[package_cache_size++];
+}
+
+struct Package_Cache_Entry *find_package_cache_entry(const char *path)
+{
+	size_t slot;
+
+	if (package_cache_index == NULL)
+		return NULL;
+
+	for (slot = name_hash(path, NULL) & package_cache_index_mask; package_cache_index[slot] != SIZE_MAX; slot = (slot + 1) & package_cache_index_mask)
+		if (strcmp(package_cache[package_cache_index[slot]].path, path) == 0)
+			return &package_cache[package_cache_index[slot]];
+
+	return NULL;
+}
+
+/** Enables the cache, loading any existing entries from filename */
+void load_package_cache(const char *filename)
+{
+	struct Mapped_File file;
+	const uint8_t *itr;
+	const uint8_t *end;
+	struct Package_Cache_Entry *entry;
+	uint32_t count;
+	uint32_t path_length;
+	char *path;
+
+	package_cache_enabled = true;
+	mutex_init(&package_cache_lock);
+
+	if (map_file(&file, filename) == false)
+		return;
+
+	itr = file.data;
+	end = file.data + file.size;
+	if (file.size >= 12 && read_uint32(itr) == PACKAGE_CACHE_MAGIC && read_uint32(itr + 4) == PACKAGE_CACHE_VERSION)
+	{
+		count = read_uint32(itr + 8);
+		itr += 12;
+
+		while (count-- != 0 && end - itr >= 36)
+		{
+			path_length = read_uint32(itr + 32);
+			if ((size_t) (end - itr) - 36 < path_length)
+				break;
+
+			path = (char *) malloc(sizeof(char) * (path_length + 1));
+			memcpy(path, itr + 36, path_length);
+			path[path_length] = '\0';
+
+			entry = add_package_cache_entry(path);
+			memcpy(&entry->size, itr, sizeof(entry->size));
+			memcpy(&entry->mtime, itr + 8, sizeof(entry->mtime));
+			memcpy(entry->GUID, itr + 16, sizeof(entry->GUID));
+
+			itr += 36 + path_length;
+		}
+	}
+
+	unmap_file(&file);
+}
+
+/** Writes the cache if anything changed; entries not seen this run are kept only if the file is unchanged */
+bool save_package_cache(const char *filename)
+{
+	struct Package_Cache_Entry *entry;
+	struct Package_Cache_Entry *end = package_cache + package_cache_size;
+	FILE *cache_file;
+	char *tmp_filename;
+	uint32_t header[3];
+	uint32_t path_length;
+	uint64_t size;
+	int64_t mtime;
+	bool result;
+
+	if (package_cache_dirty == false)
+		return true;
+
+	// confirm entries from previous runs that this run didn't visit
+	header[2] = 0;
+	for (entry = package_cache; entry != end; ++entry)
+	{
+		if (entry->seen == false)
+			entry->seen = stat_file(CURRENT_DIRECTORY_FD, entry->path, &size, &mtime) && size == entry->size && mtime == entry->mtime;
+
+		if (entry->seen)
+			++header[2];
+	}
+
+	// write to a temporary file and rename it over the old cache
+	tmp_filename = (char *) malloc(sizeof(char) * (strlen(filename) + 5));
+	sprintf(tmp_filename, "%s.tmp", filename);
+
+	cache_file = fopen(tmp_filename, "wb");
+	if (cache_file == NULL)
+	{
+		free(tmp_filename);
+		return false;
+	}
+
+	header[0] = PACKAGE_CACHE_MAGIC;
+	header[1] = PACKAGE_CACHE_VERSION;
+	fwrite(header, sizeof(uint32_t), 3, cache_file);
+
+	for (entry = package_cache; entry != end; ++entry)
+	{
+		if (entry->seen == false)
+			continue;
+
+		path_length = (uint32_t) strlen(entry->path);
+		fwrite(&entry->size, sizeof(entry->size), 1, cache_file);
+		fwrite(&entry->mtime, sizeof(entry->mtime), 1, cache_file);
+		fwrite(entry->GUID, sizeof(uint32_t), 4, cache_file);
+		fwrite(&path_length, sizeof(path_length), 1, cache_file);
+		fwrite(entry->path, sizeof(char), path_length, cache_file);
+	}
+
+	result = ferror(cache_file) == 0;
+	stat_add(stat_files_opened, 1);
+	stat_add(stat_bytes_written, ftell(cache_file));
+	stat_add(stat_syscalls, 4); // open, write, close, rename
+	result = fclose(cache_file) == 0 && result;
+
+#if defined _WIN32
+	result = result && MoveFileEx(tmp_filename, filename, MOVEFILE_REPLACE_EXISTING) != FALSE;
+#else
+	result = result && rename(tmp_filename, filename) == 0;
+#endif // _WIN32
+
+	if (result == false)
+		remove(tmp_filename);
+
+	free(tmp_filename);
+	return result;
+}
+
+/** Zeroes GUID, then fills it from the cache if it holds path at the crawled file's size and modification time; size and mtime are set when known */
+bool find_cached_guid(const struct Crawl_Entry *entry, const char *path, uint32_t *GUID, uint64_t *size, int64_t *mtime)
+{
+	struct Package_Cache_Entry *cache_entry;
+	bool cached = false;
+
+	memset(GUID, 0, sizeof(uint32_t) * 4);
+	*size = 0;
+	*mtime = 0;
+
+	if (package_cache_enabled == false || stat_crawl_entry(entry, path, size, mtime) == false)
+		return false;
+
+	mutex_lock(&package_cache_lock);
+	cache_entry = find_package_cache_entry(path);
+	if (cache_entry != NULL && cache_entry->size == *size && cache_entry->mtime == *mtime)
+	{
+		memcpy(GUID, cache_entry->GUID, sizeof(uint32_t) * 4);
+		cache_entry->seen = true;
+		cached = true;
+	}
+	mutex_unlock(&package_cache_lock);
+
+	return cached;
+}
+
+/** Records the GUID read from path at the given size and modification time */
+void store_cached_guid(const char *path, uint64_t size, int64_t mtime, const uint32_t *GUID)
+{
+	struct Package_Cache_Entry *cache_entry;
+
+	if (package_cache_enabled == false || (size == 0 && mtime == 0))
+		return;
+
+	mutex_lock(&package_cache_lock);
+	cache_entry = find_package_cache_entry(path);
+	if (cache_entry == NULL)
+		cache_entry = add_package_cache_entry(strdup(path));
+
+	cache_entry->size = size;
+	cache_entry->mtime = mtime;
+	memcpy(cache_entry->GUID, GUID, sizeof(uint32_t) * 4);
+	cache_entry->seen = true;
+	package_cache_dirty = true;
+	mutex_unlock(&package_cache_lock);
+}
+
+/** Reads the GUID of a crawled package at path, skipping the read when the cache holds it for the same size and modification time */
+void read_crawl_entry_guid(const struct Crawl_Entry *entry, const char *path, uint32_t *GUID)
+{
+	uint64_t size;
+	int64_t mtime;
+	bool opened;
+
+	if (find_cached_guid(entry, path, GUID, &size, &mtime))
+		return;
+
+#if defined _WIN32
+	opened = read_package_guid(0, path, GUID);
+#else
+	opened = read_package_guid(entry->directory_fd, entry->filename, GUID);
+#endif // _WIN32
+
+	if (opened)
+		store_cached_guid(path, size, mtime, GUID);
+}
+
+/** GUID Harvesting */
+
+/**
+ * The crawlers only collect paths; the GUIDs the package cache doesn't hold are read afterwards in one batch. On Linux
+ * the batch goes through an io_uring, keeping a few hundred files in flight: each is opened into a registered file
+ * slot, its header read, and the slot closed, all without a syscall apiece. Registered slots also keep the process
+ * file table from growing, which costs an RCU grace period per resize once the work pool's threads share it. Without
+ * io_uring (other platforms, kernels before 5.17, seccomp filters, -no-io-uring) the batch is split across the work
+ * pool instead.
+ */
+
+#define GUID_READ_QUEUE_DEPTH 256
+#define GUID_READ_TASK_SIZE 64
+
+struct GUID_Read
+{
+	const char *path; // relative to the current directory
+	uint32_t *GUID; // zeroed if the file can't be read
+	uint64_t size; // from find_cached_guid; recorded in the cache with the GUID
+	int64_t mtime;
+};
+
+bool use_io_uring = true;
+
+/** Reads one GUID synchronously, recording it in the cache */
+void read_guid_file(struct GUID_Read *read)
+{
+	memset(read->GUID, 0, sizeof(uint32_t) * 4);
+	if (read_package_guid(CURRENT_DIRECTORY_FD, read->path, read->GUID))
+		store_cached_guid(read->path, read->size, read->mtime, read->GUID);
+}
+
+#if defined HAVE_IO_URING
+struct Uring
+{
+	int fd;
+	unsigned entries;
+	unsigned tail; // queued entries; published to the kernel by submit_uring
+	unsigned submitted;
+	uint8_t *sq_ring;
+	size_t sq_ring_size;
+	uint8_t *cq_ring; // same mapping as sq_ring with IORING_FEAT_SINGLE_MMAP
+	size_t cq_ring_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_array;
+	unsigned sq_mask;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+void close_uring(struct Uring *ring)
+{
+	if (ring->sqes != NULL && ring->sqes != MAP_FAILED)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	close(ring->fd);
+}
+
+/** Sets up a ring with room for entries submissions and as many registered file slots; returns false if io_uring isn't available */
+bool open_uring(struct Uring *ring, unsigned entries)
+{
+	struct io_uring_params params;
+	int *files;
+	unsigned index;
+	int result;
+
+	memset(ring, 0, sizeof(struct Uring));
+	memset(&params, 0, sizeof(params));
+	ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+	stat_add(stat_syscalls, 1);
+	if (ring->fd < 0)
+		return false;
+
+	// Opening into a file slot needs 5.15; IORING_FEAT_CQE_SKIP (5.17) is the nearest feature bit that proves it
+	if ((params.features & IORING_FEAT_CQE_SKIP) == 0)
+	{
+		close(ring->fd);
+		return false;
+	}
+
+	ring->entries = params.sq_entries;
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (ring->cq_ring_size > ring->sq_ring_size)
+			ring->sq_ring_size = ring->cq_ring_size;
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+
+	ring->sq_ring = (uint8_t *) mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED)
+	{
+		close_uring(ring);
+		return false;
+	}
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		ring->cq_ring = ring->sq_ring;
+	else
+		ring->cq_ring = (uint8_t *) mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+
+	ring->sqes = (struct io_uring_sqe *) mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED)
+	{
+		close_uring(ring);
+		return false;
+	}
+
+	// Every file slot starts out empty
+	files = (int *) malloc(sizeof(int) * ring->entries);
+	for (index = 0; index != ring->entries; ++index)
+		files[index] = -1;
+	result = (int) syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES, files, ring->entries);
+	stat_add(stat_syscalls, 1);
+	free(files);
+	if (result < 0)
+	{
+		close_uring(ring);
+		return false;
+	}
+
+	ring->sq_head = (unsigned *) (ring->sq_ring + params.sq_off.head);
+	ring->sq_tail = (unsigned *) (ring->sq_ring + params.sq_off.tail);
+	ring->sq_array = (unsigned *) (ring->sq_ring + params.sq_off.array);
+	ring->sq_mask = *(unsigned *) (ring->sq_ring + params.sq_off.ring_mask);
+	ring->cq_head = (unsigned *) (ring->cq_ring + params.cq_off.head);
+	ring->cq_tail = (unsigned *) (ring->cq_ring + params.cq_off.tail);
+	ring->cq_mask = *(unsigned *) (ring->cq_ring + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *) (ring->cq_ring + params.cq_off.cqes);
+	ring->tail = *ring->sq_tail;
+	ring->submitted = ring->tail;
+
+	return true;
+}
+
+/** Returns a cleared submission entry to fill in; the caller never has more requests in flight than the ring has entries */
+struct io_uring_sqe *next_uring_sqe(struct Uring *ring)
+{
+	unsigned index = ring->tail++ & ring->sq_mask;
+	struct io_uring_sqe *result = &ring->sqes[index];
+
+	memset(result, 0, sizeof(struct io_uring_sqe));
+	ring->sq_array[index] = index;
+	return result;
+}
+
+/** Submits the queued entries and waits until at least min_complete requests have completed */
+bool submit_uring(struct Uring *ring, unsigned min_complete)
+{
+	int result;
+
+	__atomic_store_n(ring->sq_tail, ring->tail, __ATOMIC_RELEASE);
+	do
+	{
+		result = (int) syscall(__NR_io_uring_enter, ring->fd, ring->tail - ring->submitted, min_complete, IORING_ENTER_GETEVENTS, NULL, 0);
+		stat_add(stat_syscalls, 1);
+	} while (result < 0 && errno == EINTR);
+
+	if (result < 0)
+		return false;
+
+	ring->submitted += result;
+	return true;
+}
+
+enum GUID_Read_Stage
+{
+	guid_read_free,
+	guid_read_opening,
+	guid_read_reading,
+	guid_read_closing
+};
+
+/** One file in flight; the slot's index is also its registered file slot */
+struct GUID_Read_Slot
+{
+	struct GUID_Read *read;
+	enum GUID_Read_Stage stage;
+	uint8_t header[PACKAGE_HEADER_READ_SIZE];
+};
+
+/** True for errors meaning the kernel doesn't know the request, rather than anything wrong with the file */
+bool is_uring_unsupported(int result)
+{
+	return result == -EINVAL || result == -EOPNOTSUPP;
+}
+
+/** Settles a read from its header read's result */
+void finish_uring_guid_read(struct GUID_Read *read, const uint8_t *header, int result)
+{
+	uint64_t offset;
+
+	if (result > 0)
+		stat_add(stat_bytes_read, result);
+
+	if (is_uring_unsupported(result))
+		read_guid_file(read);
+	else if (result >= 0 && decode_header_guid(header, result, read->GUID, &offset))
+		store_cached_guid(read->path, read->size, read->mtime, read->GUID);
+	else if (result == PACKAGE_HEADER_READ_SIZE)
+		read_guid_file(read); // long folder name
+	else
+	{
+		// A file too short for a header keeps a zero GUID, as it always has
+		memset(read->GUID, 0, sizeof(uint32_t) * 4);
+		store_cached_guid(read->path, read->size, read->mtime, read->GUID);
+	}
+}
+
+/** Reads the GUIDs through an io_uring: every slot opens a file, reads its header, then closes it; returns false if io_uring isn't available */
+bool read_guids_uring(struct GUID_Read *reads, size_t count)
+{
+	struct Uring ring;
+	struct GUID_Read_Slot *slots;
+	struct GUID_Read_Slot *slot;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	size_t *free_slots;
+	size_t free_count = 0;
+	size_t slot_count = count < GUID_READ_QUEUE_DEPTH ? count : GUID_READ_QUEUE_DEPTH;
+	size_t next = 0;
+	size_t in_flight = 0;
+	size_t index;
+	unsigned head;
+	unsigned tail;
+	bool failed = false;
+
+	if (open_uring(&ring, GUID_READ_QUEUE_DEPTH) == false)
+		return false;
+
+	if (slot_count > ring.entries)
+		slot_count = ring.entries;
+
+	slots = (struct GUID_Read_Slot *) malloc(sizeof(struct GUID_Read_Slot) * slot_count);
+	free_slots = (size_t *) malloc(sizeof(size_t) * slot_count);
+	for (index = slot_count; index != 0; --index)
+	{
+		slots[index - 1].stage = guid_read_free;
+		free_slots[free_count++] = index - 1;
+	}
+
+	while (next != count || in_flight != 0)
+	{
+		// Every free slot starts on the next file
+		while (free_count != 0 && next != count)
+		{
+			index = free_slots[--free_count];
+			slot = &slots[index];
+			slot->read = &reads[next++];
+			slot->stage = guid_read_opening;
+
+			sqe = next_uring_sqe(&ring);
+			sqe->opcode = IORING_OP_OPENAT;
+			sqe->fd = AT_FDCWD;
+			sqe->addr = (uintptr_t) slot->read->path;
+			sqe->open_flags = O_RDONLY; // registered files are never inherited; O_CLOEXEC is rejected
+			sqe->file_index = (uint32_t) index + 1;
+			sqe->user_data = index;
+			++in_flight;
+		}
+
+		if (submit_uring(&ring, 1) == false)
+		{
+			failed = true;
+			break;
+		}
+
+		head = *ring.cq_head;
+		tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; ++head)
+		{
+			cqe = &ring.cqes[head & ring.cq_mask];
+			index = (size_t) cqe->user_data;
+			slot = &slots[index];
+
+			if (slot->stage == guid_read_opening && cqe->res >= 0)
+			{
+				stat_add(stat_files_opened, 1);
+				slot->stage = guid_read_reading;
+
+				sqe = next_uring_sqe(&ring);
+				sqe->opcode = IORING_OP_READ;
+				sqe->flags = IOSQE_FIXED_FILE;
+				sqe->fd = (int32_t) index;
+				sqe->addr = (uintptr_t) slot->header;
+				sqe->len = PACKAGE_HEADER_READ_SIZE;
+				sqe->off = 0;
+				sqe->user_data = index;
+				continue;
+			}
+
+			if (slot->stage == guid_read_reading)
+			{
+				finish_uring_guid_read(slot->read, slot->header, cqe->res);
+				slot->stage = guid_read_closing;
+
+				sqe = next_uring_sqe(&ring);
+				sqe->opcode = IORING_OP_CLOSE;
+				sqe->file_index = (uint32_t) index + 1;
+				sqe->user_data = index;
+				continue;
+			}
+
+			if (slot->stage == guid_read_opening)
+			{
+				// A file that can't be opened keeps a zero GUID, as it always has
+				if (is_uring_unsupported(cqe->res))
+					read_guid_file(slot->read);
+				else
+					memset(slot->read->GUID, 0, sizeof(uint32_t) * 4);
+			}
+
+			slot->stage = guid_read_free;
+			free_slots[free_count++] = index;
+			--in_flight;
+		}
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	// Closing the ring closes every registered file
+	close_uring(&ring);
+
+	// The ring broke down mid-batch; whatever it didn't finish is read the slow way
+	if (failed)
+	{
+		for (index = 0; index != slot_count; ++index)
+			if (slots[index].stage == guid_read_opening || slots[index].stage == guid_read_reading)
+				read_guid_file(slots[index].read);
+		for (; next != count; ++next)
+			read_guid_file(&reads[next]);
+	}
+
+	free(free_slots);
+	free(slots);
+	return true;
+}
+#endif // HAVE_IO_URING
+
+struct GUID_Read_Task
+{
+	struct GUID_Read *reads;
+	size_t count;
+	struct Work_Group *group;
+};
+
+void read_guids_task(struct Work_Pool *pool, size_t worker, void *data)
+{
+	struct GUID_Read_Task *task = (struct GUID_Read_Task *) data;
+	size_t index;
+
+	(void) worker;
+
+	for (index = 0; index != task->count; ++index)
+		read_guid_file(&task->reads[index]);
+
+	work_group_done(pool, task->group);
+}
+
+/** Fills in the GUID of every read */
+void read_guids(struct GUID_Read *reads, size_t count)
+{
+	struct Work_Pool *pool;
+	struct Work_Group group = { 0 };
+	struct GUID_Read_Task *tasks;
+	size_t task_count;
+	size_t index;
+
+	if (count == 0)
+		return;
+
+#if defined HAVE_IO_URING
+	if (use_io_uring && read_guids_uring(reads, count))
+		return;
+#endif // HAVE_IO_URING
+
+	pool = get_work_pool();
+	task_count = (count + GUID_READ_TASK_SIZE - 1) / GUID_READ_TASK_SIZE;
+	tasks = (struct GUID_Read_Task *) malloc(sizeof(struct GUID_Read_Task) * task_count);
+	for (index = 0; index != task_count; ++index)
+	{
+		tasks[index].reads = reads + index * GUID_READ_TASK_SIZE;
+		tasks[index].count = index + 1 == task_count ? count - index * GUID_READ_TASK_SIZE : GUID_READ_TASK_SIZE;
+		tasks[index].group = &group;
+		work_group_add(pool, &group);
+		work_pool_push(pool, SIZE_MAX, read_guids_task, &tasks[index]);
+	}
+	work_group_wait(pool, SIZE_MAX, &group);
+
+	free(tasks);
+}
+
+/** Package Table Functions */
+
+void init_package_table()
+{
+	struct UDKPackage *itr;
+	struct UDKPackage *end;
+	size_t index = 0;
+
+	package_table = (struct UDKPackage *) malloc(sizeof(struct UDKPackage) * packages_imported);
+	itr = package_table;
+	end = package_table + packages_imported;
+
+	while (itr != end)
+	{
+		if (import_table[index].package_reference == 0)
+		{
+			memset(itr->GUID, 0, sizeof(itr->GUID));
+			itr->name_index = import_table[index].object_name_index;
+			itr->name = NULL;
+			itr->filename = NULL;
+			itr->extension = ext_UNKNOWN;
+			++itr;
+		}
+		++index;
+	}
+}
+
+mutex_t package_table_lock;
+
+/** Package table index; open addressing by case-insensitive name, slots hold package_table indices (SIZE_MAX if empty). Only exists while crawling, and only holds packages that were unresolved when the crawl started */
+size_t *package_table_index = NULL;
+size_t package_table_index_mask = 0;
+size_t packages_unresolved = 0; // indexed packages without a filename yet; later searches are skipped once this reaches 0
+char *package_search_bound = NULL; // highest path the current search has claimed for a package that had none
+struct GUID_Read *package_guid_reads = NULL; // parallel to package_table; set for claimed files whose GUID is read once the crawl is done
+
+/** Directories under the game path searched before the rest of it, in order (-prefer) */
+const char **search_roots = NULL;
+size_t search_roots_size = 0;
+
+void build_package_table_index()
+{
+	size_t capacity = 16;
+	size_t index;
+	size_t slot;
+	const char *name;
+
+	while (capacity < packages_imported * 2)
+		capacity *= 2;
+
+	package_table_index = (size_t *) malloc(sizeof(size_t) * capacity);
+	memset(package_table_index, 0xFF, sizeof(size_t) * capacity);
+	package_table_index_mask = capacity - 1;
+	packages_unresolved = 0;
+
+	for (index = 0; index != packages_imported; ++index)
+	{
+		if (package_table[index].filename != NULL)
+			continue;
+
+		++packages_unresolved;
+		name = get_name(package_table[index].name_index);
+		for (slot = name_hash(name, NULL) & package_table_index_mask; package_table_index[slot] != SIZE_MAX; slot = (slot + 1) & package_table_index_mask);
+		package_table_index[slot] = index;
+	}
+}
+
+/** Case-insensitive lookup of [name, name_end) among the imported packages */
+struct UDKPackage *find_imported_package(const char *name, const char *name_end)
+{
+	size_t slot;
+
+	for (slot = name_hash(name, name_end) & package_table_index_mask; package_table_index[slot] != SIZE_MAX; slot = (slot + 1) & package_table_index_mask)
+		if (streql_2ptr(name, name_end, get_name(package_table[package_table_index[slot]].name_index)))
+			return &package_table[package_table_index[slot]];
+
+	return NULL;
+}
+
+void match_package_table(const struct Crawl_Entry *entry, void *context)
+{
+	struct UDKPackage *package;
+	char *filename;
+	uint32_t GUID[4];
+	uint64_t size;
+	int64_t mtime;
+	bool cached;
+	bool claimed;
+
+	(void) context;
+
+	// check if package name matches a package in the table
+	package = find_imported_package(entry->filename, entry->name_end);
+	if (package == NULL)
+		return;
+
+	filename = crawl_entry_path(entry);
+	cached = find_cached_guid(entry, filename, GUID, &size, &mtime);
+
+	// Several directories may hold the same package; keep the lowest path so results don't depend on thread timing
+	mutex_lock(&package_table_lock);
+	claimed = package->filename == NULL || strcmp(filename, package->filename) < 0;
+	if (claimed)
+	{
+		if (package->filename == NULL)
+		{
+			--packages_unresolved;
+			if (package_search_bound == NULL || strcmp(filename, package_search_bound) > 0)
+			{
+				free(package_search_bound);
+				package_search_bound = strdup(filename);
+			}
+		}
+		free(package->filename);
+		package->filename = filename;
+		package->extension = entry->extension;
+		memcpy(package->GUID, GUID, sizeof(GUID));
+		package_guid_reads[package - package_table].GUID = cached ? NULL : package->GUID;
+		package_guid_reads[package - package_table].size = size;
+		package_guid_reads[package - package_table].mtime = mtime;
+	}
+	mutex_unlock(&package_table_lock);
+
+	if (claimed == false)
+		free(filename);
+}
+
+/**
+ * Once every package has a candidate, a directory that sorts after all of them can only hold higher paths, so it is
+ * left unread. Directories that could still hold a lower copy are always read, which keeps the result the same as a
+ * full crawl whatever order the workers get to them in.
+ */
+bool want_package_directory(const char *path, void *context)
+{
+	bool result;
+
+	(void) context;
+
+	mutex_lock(&package_table_lock);
+	result = packages_unresolved != 0 || strcmp(path, package_search_bound) < 0;
+	mutex_unlock(&package_table_lock);
+	return result;
+}
+
+/** Crawls directory for the packages still unresolved, stopping at directories that can't hold a lower path once they have all been found */
+bool search_package_table(const char *directory)
+{
+	bool result = true;
+
+	build_package_table_index();
+	if (packages_unresolved != 0)
+		result = crawl_packages(directory, match_package_table, want_package_directory, NULL);
+
+	free(package_search_bound);
+	package_search_bound = NULL;
+	free(package_table_index);
+	package_table_index = NULL;
+	return result;
+}
+
+/**
+ * Finds the imported packages under directory: first in each search root in order, then anywhere. A package found in
+ * an earlier root is never replaced by a later one, so -prefer order breaks ties between roots; within one search, the
+ * lowest path wins. Once every import is found, the remaining searches (including the full one) are skipped.
+ */
+bool build_package_table(const char *directory)
+{
+	size_t read_count = 0;
+	char *root;
+	size_t index;
+	bool result;
+
+	mutex_init(&package_table_lock);
+	package_guid_reads = (struct GUID_Read *) calloc(packages_imported + 1, sizeof(struct GUID_Read));
+
+	for (index = 0; index != search_roots_size; ++index)
+	{
+		root = (char *) malloc(sizeof(char) * (strlen(directory) + strlen(search_roots[index]) + 2));
+		if (*directory != '\0')
+			sprintf(root, "%s%c%s", directory, PATH_SEPARATOR, search_roots[index]);
+		else
+			strcpy(root, search_roots[index]);
+
+		// A missing root is fine; not every install has every directory
+		search_package_table(root);
+		free(root);
+	}
+
+	result = search_package_table(directory);
+	mutex_destroy(&package_table_lock);
+
+	// Only the copies that won are read
+	for (index = 0; index != packages_imported; ++index)
+		if (package_guid_reads[index].GUID != NULL)
+		{
+			package_guid_reads[read_count] = package_guid_reads[index];
+			package_guid_reads[read_count].path = package_table[index].filename;
+			++read_count;
+		}
+	read_guids(package_guid_reads, read_count);
+
+	free(package_guid_reads);
+	package_guid_reads = NULL;
+	return result;
+}
+
+void print_package_table(struct Writer *out)
+{
+	size_t index;
+	struct UDKPackage *itr = package_table;
+
+	if (output_format == format_binary)
+		writer_put_dump_header(out, PACKAGE_TABLE_MAGIC, packages_imported);
+
+	for (index = 0; index != packages_imported; ++index, ++itr)
+	{
+		if (output_format != format_text)
+		{
+			writer_put_package_record(out, itr->GUID, get_name(itr->name_index), itr->filename);
+			continue;
+		}
+
+		writer_put_guid(out, itr->GUID);
+		writer_write(out, " | ", 3);
+		writer_puts(out, get_name(itr->name_index));
+		writer_putc(out, '\n');
+	}
+}
+
+/** Pruning Analysis */
+
+/**
+ * A dependency ships whole even if the map only uses one object from it. Every import below a package import names an
+ * object in that package; matching it (by name and outer name) against the package's export table tells which exports
+ * the map really references. Exports nested inside a referenced export (components, subobjects) are counted with it.
+ * A package the map imports by name is loaded by UE3 whether or not any object in it is used, so nothing is ever left
+ * out; -prune only warns about those packages, and the per-object lists in -prune-report are the slimmed manifest.
+ */
+
+struct Package_Usage
+{
+	bool analyzed; // false if the package is unresolved, against-listed or couldn't be read
+	uint64_t file_size;
+	uint64_t export_size; // serial size of every export
+	uint64_t referenced_size; // serial size of the referenced exports and everything nested in them
+	uint32_t objects_imported; // imports of objects inside this package
+	uint32_t objects_found; // of which were found in its export table
+	uint32_t *objects; // exports the map imports directly
+	uint32_t objects_size;
+	uint32_t exports_referenced;
+};
+
+bool prune_dependencies = false; // warn about dependencies the map doesn't reference any objects from
+struct Package_Usage *package_usage = NULL; // parallel to package_table
+size_t *import_packages = NULL; // package table index of each import's outermost package; SIZE_MAX if none
+
+void free_package_usage()
+{
+	size_t index;
+
+	if (package_usage != NULL)
+	{
+		for (index = 0; index != packages_imported; ++index)
+			free(package_usage[index].objects);
+		free(package_usage);
+		package_usage = NULL;
+	}
+
+	free(import_packages);
+	import_packages = NULL;
+}
+
+/** Maps every import to the package import at the end of its outer chain */
+void build_import_packages()
+{
+	size_t *table_index = (size_t *) malloc(sizeof(size_t) * (import_table_size + 1));
+	size_t package_index = 0;
+	int32_t reference;
+	uint32_t index;
+	uint32_t outer;
+	uint32_t depth;
+
+	import_packages = (size_t *) malloc(sizeof(size_t) * (import_table_size + 1));
+
+	// package table entries are the package imports in table order
+	for (index = 0; index != import_table_size; ++index)
+		table_index[index] = import_table[index].package_reference == 0 ? package_index++ : SIZE_MAX;
+
+	for (index = 0; index != import_table_size; ++index)
+	{
+		import_packages[index] = SIZE_MAX;
+		outer = index;
+
+		// depth bounds the walk in case the outers form a cycle
+		for (depth = 0; depth != import_table_size; ++depth)
+		{
+			reference = import_table[outer].package_reference;
+			if (reference == 0)
+			{
+				import_packages[index] = table_index[outer];
+				break;
+			}
+
+			// an export outer means the import lives inside the map itself
+			if (reference > 0 || (uint32_t) -(int64_t) reference > import_table_size)
+				break;
+			outer = (uint32_t) (-(int64_t) reference - 1);
+		}
+	}
+
+	free(table_index);
+}
+
+/** Finds the export an object import refers to; the outer's name must match too, since object names repeat across groups */
+uint32_t find_imported_export(struct UDKPackage_File *package, uint32_t import_index)
+{
+	const struct UDKImport *import = &import_table[import_index];
+	const struct UDKImport *outer = &import_table[-(int64_t) import->package_reference - 1];
+	const char *name = get_name(import->object_name_index);
+	const char *outer_name = get_name(outer->object_name_index);
+	struct UDKExport export;
+	uint32_t index;
+
+	for (index = find_export(package, name, name + strlen(name)); index != INVALID_NAME; index = next_export_with_name(package, index))
+	{
+		if (get_export(package, index, &export) == false)
+			continue;
+
+		if (outer->package_reference == 0)
+		{
+			if (export.outer_index == 0)
+				return index;
+		}
+		else if (export.outer_index > 0 && strcmpi(get_object_reference_name(package, export.outer_index), outer_name) == 0)
+			return index;
+	}
+
+	return INVALID_NAME;
+}
+
+/** Marks every export whose outer chain passes through a referenced export; outers may come after the exports inside them */
+void mark_nested_exports(struct UDKPackage_File *package, uint8_t *referenced, struct Package_Usage *usage)
+{
+	uint32_t count = package->summary.export_count;
+	uint32_t *chain = (uint32_t *) malloc(sizeof(uint32_t) * (count + 1));
+	uint32_t chain_size;
+	uint32_t index;
+	uint32_t outer;
+	uint8_t state;
+	struct UDKExport export;
+
+	// referenced: 0 = unknown, 1 = referenced, 2 = not referenced
+	for (index = 0; index != count; ++index)
+	{
+		chain_size = 0;
+		state = 2;
+		outer = index;
+
+		while (chain_size != count)
+		{
+			if (referenced[outer] != 0)
+			{
+				state = referenced[outer];
+				break;
+			}
+
+			chain[chain_size++] = outer;
+			if (get_export(package, outer, &export) == false || export.outer_index <= 0 || (uint32_t) export.outer_index > count)
+				break;
+			outer = (uint32_t) export.outer_index - 1;
+		}
+
+		while (chain_size != 0)
+			referenced[chain[--chain_size]] = state;
+	}
+
+	for (index = 0; index != count; ++index)
+		if (referenced[index] == 1 && get_export(package, index, &export))
+		{
+			usage->referenced_size += export.serial_size;
+			++usage->exports_referenced;
+		}
+
+	free(chain);
+}
+
+struct Package_Usage_Job
+{
+	size_t index;
+	struct Work_Group *group;
+};
+
+void analyze_package_usage_task(struct Work_Pool *pool, size_t worker, void *data)
+{
+	struct Package_Usage_Job *job = (struct Package_Usage_Job *) data;
+	struct Package_Usage *usage = &package_usage[job->index];
+	struct UDKPackage_File file;
+	struct UDKExport export;
+	uint8_t *referenced;
+	uint32_t index;
+	uint32_t found;
+
+	(void) worker;
+
+	if (open_package_file(&file, package_table[job->index].filename) == false)
+	{
+		printf("ERROR: Unable to read dependency %s\n", package_table[job->index].filename);
+		work_group_done(pool, job->group);
+		free(job);
+		return;
+	}
+
+	usage->file_size = file.file.size;
+	referenced = (uint8_t *) calloc(file.summary.export_count + 1, 1);
+
+	for (index = 0; index != file.summary.export_count && get_export(&file, index, &export); ++index)
+		usage->export_size += export.serial_size;
+	usage->analyzed = index == file.summary.export_count;
+
+	for (index = 0; usage->analyzed && index != import_table_size; ++index)
+	{
+		if (import_packages[index] != job->index || import_table[index].package_reference == 0)
+			continue;
+
+		++usage->objects_imported;
+		found = find_imported_export(&file, index);
+		if (found == INVALID_NAME)
+			continue;
+
+		// groups are only outers for the objects imported from them, not references to everything inside
+		++usage->objects_found;
+		if (referenced[found] == 0 && strcmpi(get_name(import_table[index].class_name_index), "Package") != 0)
+		{
+			referenced[found] = 1;
+			usage->objects = (uint32_t *) realloc(usage->objects, sizeof(uint32_t) * (usage->objects_size + 1));
+			usage->objects[usage->objects_size++] = found;
+		}
+	}
+
+	if (usage->analyzed)
+		mark_nested_exports(&file, referenced, usage);
+	else
+		printf("ERROR: Malformed export table in dependency %s\n", package_table[job->index].filename);
+
+	free(referenced);
+	close_package_file(&file);
+	work_group_done(pool, job->group);
+	free(job);
+}
+
+/** Cross-references the map's object imports against the export tables of its direct dependencies; requires the package table */
+void analyze_package_usage()
+{
+	struct Work_Pool *pool = get_work_pool();
+	struct Work_Group group = { 0 };
+	struct Package_Usage_Job *job;
+	size_t index;
+
+	free_package_usage();
+	package_usage = (struct Package_Usage *) calloc(packages_imported + 1, sizeof(struct Package_Usage));
+	build_import_packages();
+
+	for (index = 0; index != packages_imported; ++index)
+		if (package_table[index].filename != NULL && is_in_against_list(package_table[index].GUID) == false)
+		{
+			job = (struct Package_Usage_Job *) malloc(sizeof(struct Package_Usage_Job));
+			job->index = index;
+			job->group = &group;
+			work_group_add(pool, &group);
+			work_pool_push(pool, SIZE_MAX, analyze_package_usage_task, job);
+		}
+
+	work_group_wait(pool, SIZE_MAX, &group);
+}
+
+/** Warns about every analyzed dependency none of whose objects the map imports; they still ship, since the map names them */
+void warn_unused_packages()
+{
+	size_t index;
+
+	for (index = 0; index != packages_imported; ++index)
+		if (package_usage[index].analyzed && package_usage[index].objects_imported == 0)
+			printf("WARNING: %s is imported but none of its objects are\n", get_name(package_table[index].name_index));
+}
+
+void print_package_usage(FILE *out)
+{
+	const struct Package_Usage *usage;
+	const struct UDKPackage *package;
+	struct UDKPackage_File file;
+	struct UDKExport export;
+	uint64_t file_size = 0;
+	uint64_t export_size = 0;
+	uint64_t referenced_size = 0;
+	uint64_t unused_size = 0;
+	size_t analyzed = 0;
+	size_t unused = 0;
+	size_t index;
+	uint32_t object;
+	const char *name;
+	int32_t length;
+
+	for (index = 0; index != packages_imported; ++index)
+		if (package_usage[index].analyzed)
+		{
+			++analyzed;
+			file_size += package_usage[index].file_size;
+			export_size += package_usage[index].export_size;
+			referenced_size += package_usage[index].referenced_size;
+			if (package_usage[index].objects_imported == 0)
+			{
+				++unused;
+				unused_size += package_usage[index].file_size;
+			}
+		}
+
+	fprintf(out, "%u dependencies analyzed | Referenced: %llu of %llu export bytes (%.1f%%) | Shipped: %llu bytes | Unused: %u packages, %llu bytes\n",
+		(unsigned int) analyzed, (unsigned long long) referenced_size, (unsigned long long) export_size, export_size != 0 ? 100.0 * referenced_size / export_size : 0.0,
+		(unsigned long long) file_size, (unsigned int) unused, (unsigned long long) unused_size);
+
+	for (index = 0; index != packages_imported; ++index)
+	{
+		usage = &package_usage[index];
+		package = &package_table[index];
+		if (usage->analyzed == false)
+			continue;
+
+		fprintf(out, "%.8X%.8X%.8X%.8X | %s | Referenced: %llu of %llu export bytes | Shipped: %llu bytes | Objects: %u of %u found | Exports: %u%s\n",
+			package->GUID[0], package->GUID[1], package->GUID[2], package->GUID[3], get_name(package->name_index),
+			(unsigned long long) usage->referenced_size, (unsigned long long) usage->export_size, (unsigned long long) usage->file_size,
+			usage->objects_found, usage->objects_imported, usage->exports_referenced, usage->objects_imported == 0 ? " | Unused" : "");
+
+		// the referenced objects are the slimmed contents of the package
+		if (usage->objects_size == 0 || open_package_file(&file, package->filename) == false)
+			continue;
+		for (object = 0; object != usage->objects_size; ++object)
+			if (get_export(&file, usage->objects[object], &export))
+				fprintf(out, "\t%u | %s | Offset: %u | Size: %u\n", usage->objects[object],
+					get_package_file_name(&file, export.object_name_index, &name, &length) ? name : "?", export.serial_offset, export.serial_size);
+		close_package_file(&file);
+	}
+}
+
+/** Dependency Table Functions */
+
+const char *get_package_name(const struct UDKPackage *package)
+{
+	if (package->name_index != INVALID_NAME)
+		return get_name(package->name_index);
+	return package->name;
+}
+
+void append_dependency(struct UDKPackage *package)
+{
+	if (dependency_list_size == dependency_list_capacity)
+	{
+		dependency_list_capacity = dependency_list_capacity == 0 ? 64 : dependency_list_capacity * 2;
+		dependency_list = (struct UDKPackage **) realloc(dependency_list, sizeof(struct UDKPackage *) * dependency_list_capacity);
+	}
+
+	dependency_list[dependency_list_size++] = package;
+}
+
+void build_dependency_list()
+{
+	size_t index;
+
+	for (index = 0; index != packages_imported; ++index)
+		if (is_in_against_list(package_table[index].GUID) == false)
+			append_dependency(&package_table[index]);
+}
+
+void write_dependency_list(FILE *out)
+{
+	uint32_t index;
+
+	fwrite(&dependency_list_size, sizeof(uint32_t), 1, out);
+	for (index = 0; index != dependency_list_size; ++index)
+		fwrite(dependency_list[index]->GUID, sizeof(uint32_t), 4, out);
+}
+
+void print_dependency_list(struct Writer *out)
+{
+	const struct UDKPackage *package;
+	uint32_t index;
+
+	if (output_format == format_binary)
+		writer_put_dump_header(out, DEPENDENCY_LIST_MAGIC, dependency_list_size);
+	else if (output_format == format_text)
+	{
+		writer_put_decimal(out, dependency_list_size);
+		writer_puts(out, " dependencies:\n");
+	}
+
+	for (index = 0; index != dependency_list_size; ++index)
+	{
+		package = dependency_list[index];
+		if (output_format != format_text)
+		{
+			writer_put_package_record(out, package->GUID, get_package_name(package), package->filename);
+			continue;
+		}
+
+		writer_put_guid(out, package->GUID);
+		writer_write(out, " | ", 3);
+		writer_puts(out, get_package_name(package));
+		writer_write(out, " | ", 3);
+		if (package->filename != NULL)
+			writer_puts(out, package->filename);
+		writer_putc(out, '\n');
+	}
+}
+
+/** Game Package Table Functions */
+
+/** Fills in a package from a crawl entry, with one allocation holding both its path and its name; the GUID is left zeroed */
+void init_UDKPackage_Game(struct UDKPackage_Game *package, const struct Crawl_Entry *entry)
+{
+	size_t path_length = entry->directory_length + entry->filename_length;
+	size_t name_length = entry->name_end - entry->filename;
+
+	package->filename = (char *) malloc(sizeof(char) * (path_length + name_length + 2));
+	memcpy(package->filename, entry->directory, entry->directory_length);
+	memcpy(package->filename + entry->directory_length, entry->filename, entry->filename_length);
+	package->filename[path_length] = '\0';
+
+	package->name = package->filename + path_length + 1;
+	memcpy(package->name, entry->filename, name_length);
+	package->name[name_length] = '\0';
+
+	package->extension = entry->extension;
+	memset(package->GUID, 0, sizeof(package->GUID));
+}
+
+/** Appends a copy of package; pointers into the table are only valid until the next call */
+struct UDKPackage_Game *add_UDKPackage_Game(const struct UDKPackage_Game *package)
+{
+	if (game_package_table_size == game_package_table_capacity)
+	{
+		game_package_table_capacity = game_package_table_capacity == 0 ? 1024 : game_package_table_capacity * 2;
+		game_package_table = (struct UDKPackage_Game *) realloc(game_package_table, sizeof(struct UDKPackage_Game) * game_package_table_capacity);
+	}
+
+	game_package_table[game_package_table_size] = *package;
+	return &game_package_table[game_package_table_size++];
+}
+
+mutex_t game_package_table_lock;
+
+/** Packages added by the current crawl whose GUIDs weren't in the cache, in table order; GUID is set once the table stops moving */
+struct GUID_Read *game_package_reads = NULL;
+size_t game_package_reads_size = 0;
+size_t game_package_reads_capacity = 0;
+
+void add_game_package(const struct Crawl_Entry *entry, void *context)
+{
+	struct UDKPackage_Game package;
+	uint64_t size;
+	int64_t mtime;
+	bool cached;
+
+	(void) context;
+
+	// Only the append is locked; the table may move while other workers add to it
+	init_UDKPackage_Game(&package, entry);
+	cached = find_cached_guid(entry, package.filename, package.GUID, &size, &mtime);
+
+	mutex_lock(&game_package_table_lock);
+	if (cached == false)
+	{
+		if (game_package_reads_size == game_package_reads_capacity)
+		{
+			game_package_reads_capacity = game_package_reads_capacity == 0 ? 1024 : game_package_reads_capacity * 2;
+			game_package_reads = (struct GUID_Read *) realloc(game_package_reads, sizeof(struct GUID_Read) * game_package_reads_capacity);
+		}
+		game_package_reads[game_package_reads_size].path = package.filename;
+		game_package_reads[game_package_reads_size].GUID = NULL;
+		game_package_reads[game_package_reads_size].size = size;
+		game_package_reads[game_package_reads_size].mtime = mtime;
+		++game_package_reads_size;
+	}
+	add_UDKPackage_Game(&package);
+	mutex_unlock(&game_package_table_lock);
+}
+
+bool build_game_package_table(const char *directory)
+{
+	size_t start = game_package_table_size;
+	size_t read = 0;
+	size_t index;
+	bool result;
+
+	mutex_init(&game_package_table_lock);
+	result = crawl_packages(directory, add_game_package, NULL, NULL);
+	mutex_destroy(&game_package_table_lock);
+
+	// The table has stopped moving, so the reads can point into it; both were appended under the same lock, in the same order
+	for (index = start; index != game_package_table_size && read != game_package_reads_size; ++index)
+		if (game_package_table[index].filename == game_package_reads[read].path)
+			game_package_reads[read++].GUID = game_package_table[index].GUID;
+	read_guids(game_package_reads, game_package_reads_size);
+
+	free(game_package_reads);
+	game_package_reads = NULL;
+	game_package_reads_size = 0;
+	game_package_reads_capacity = 0;
+	return result;
+}
+
+void free_game_package_table()
+{
+	size_t index;
+
+	for (index = 0; index != game_package_table_size; ++index)
+		free_UDKPackage_Game(&game_package_table[index]);
+	free(game_package_table);
+	game_package_table = NULL;
+	game_package_table_size = 0;
+	game_package_table_capacity = 0;
+
+	free(game_package_index);
+	game_package_index = NULL;
+	game_package_index_mask = 0;
+}
+
+/** Removes the package at path, or every package under path if it's a directory (with a trailing separator); the index must be rebuilt afterwards */
+size_t remove_game_packages(const char *path, bool is_directory)
+{
+	struct UDKPackage_Game *package;
+	size_t path_length = strlen(path);
+	size_t kept = 0;
+	size_t index;
+
+	// Compacted in place, keeping the table in order
+	for (index = 0; index != game_package_table_size; ++index)
+	{
+		package = &game_package_table[index];
+		if (is_directory ? strncmp(package->filename, path, path_length) == 0 : strcmp(package->filename, path) == 0)
+			free_UDKPackage_Game(package);
+		else
+			game_package_table[kept++] = *package;
+	}
+
+	index = game_package_table_size - kept;
+	game_package_table_size = kept;
+	return index;
+}
+
+#if !defined _WIN32
+/** Adds or refreshes the package name in directory (which has a trailing separator); returns false if it isn't a package or can't be read. The index must be rebuilt afterwards */
+bool update_game_package(const char *directory, const char *name)
+{
+	struct Crawl_Entry entry;
+	struct UDKPackage_Game *package = NULL;
+	struct UDKPackage_Game added;
+	char *path;
+	size_t index;
+
+	entry.name_end = find_package_extension(name, strlen(name), &entry.extension);
+	if (entry.name_end == NULL)
+		return false;
+
+	entry.directory = directory;
+	entry.directory_length = strlen(directory);
+	entry.filename = name;
+	entry.filename_length = strlen(name);
+	entry.directory_fd = open(*directory == '\0' ? "." : directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	stat_add(stat_syscalls, 1);
+	if (entry.directory_fd < 0)
+		return false;
+
+	path = crawl_entry_path(&entry);
+	for (index = 0; index != game_package_table_size && package == NULL; ++index)
+		if (strcmp(game_package_table[index].filename, path) == 0)
+			package = &game_package_table[index];
+	free(path);
+
+	if (package == NULL)
+	{
+		init_UDKPackage_Game(&added, &entry);
+		package = add_UDKPackage_Game(&added);
+	}
+
+	read_crawl_entry_guid(&entry, package->filename, package->GUID);
+	close(entry.directory_fd);
+	return true;
+}
+#endif // _WIN32
+
+/** Indexes the game package table by name; where a name is installed more than once, the lowest path wins */
+void build_game_package_index()
+{
+	struct UDKPackage_Game *package;
+	size_t capacity = 16;
+	size_t index;
+	size_t slot;
+
+	while (capacity < game_package_table_size * 2)
+		capacity *= 2;
+
+	free(game_package_index);
+	game_package_index = (size_t *) malloc(sizeof(size_t) * capacity);
+	memset(game_package_index, 0xFF, sizeof(size_t) * capacity);
+	game_package_index_mask = capacity - 1;
+
+	for (index = 0; index != game_package_table_size; ++index)
+	{
+		package = &game_package_table[index];
+		for (slot = name_hash(package->name, NULL) & game_package_index_mask; game_package_index[slot] != SIZE_MAX; slot = (slot + 1) & game_package_index_mask)
+			if (strcmpi(game_package_table[game_package_index[slot]].name, package->name) == 0)
+				break;
+
+		if (game_package_index[slot] == SIZE_MAX || strcmp(package->filename, game_package_table[game_package_index[slot]].filename) < 0)
+			game_package_index[slot] = index;
+	}
+}
+
+/** Case-insensitive lookup of [name, name_end) in the game package index */
+struct UDKPackage_Game *find_game_package(const char *name, const char *name_end)
+{
+	size_t slot;
+
+	if (game_package_index == NULL)
+		return NULL;
+
+	for (slot = name_hash(name, name_end) & game_package_index_mask; game_package_index[slot] != SIZE_MAX; slot = (slot + 1) & game_package_index_mask)
+		if (streql_2ptr(name, name_end, game_package_table[game_package_index[slot]].name))
+			return &game_package_table[game_package_index[slot]];
+
+	return NULL;
+}
+
+/** Fills the package table from the game package index instead of crawling */
+void resolve_package_table()
+{
+	struct UDKPackage *package;
+	struct UDKPackage *end = package_table + packages_imported;
+	struct UDKPackage_Game *game_package;
+	const char *name;
+
+	for (package = package_table; package != end; ++package)
+	{
+		name = get_name(package->name_index);
+		game_package = find_game_package(name, name + strlen(name));
+		if (game_package != NULL)
+		{
+			package->filename = strdup(game_package->filename);
+			package->extension = game_package->extension;
+			memcpy(package->GUID, game_package->GUID, sizeof(package->GUID));
+		}
+	}
+}
+
+void print_game_package_table(struct Writer *out)
+{
+	struct UDKPackage_Game *itr = game_package_table;
+	struct UDKPackage_Game *end = game_package_table + game_package_table_size;
+
+	if (output_format == format_binary)
+		writer_put_dump_header(out, GAME_PACKAGE_TABLE_MAGIC, (uint32_t) game_package_table_size);
+
+	for (; itr != end; ++itr)
+	{
+		if (output_format != format_text)
+		{
+			writer_put_package_record(out, itr->GUID, itr->name, itr->filename);
+			continue;
+		}
+
+		writer_put_guid(out, itr->GUID);
+		writer_write(out, " | ", 3);
+		writer_puts(out, itr->name);
+		writer_putc(out, '\n');
+	}
+}
+
+/** Game Package Watcher */
+
+/**
+ * Keeps the game package table in step with the game directory, so a long-running process never crawls it twice. Every
+ * directory under the game path is watched with inotify; a package that is written, moved or deleted is updated in
+ * place (reading only that file's GUID), and the index is rebuilt from memory after each batch of events. If the
+ * kernel drops events, the table is rebuilt from a fresh crawl.
+ */
+
+#if defined __linux__
+
+#define GAME_WATCHER_EVENTS (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+#define GAME_WATCHER_SETTLE_MS 250 // a patch touches many files at once; wait this long for the next event before acting
+
+struct Game_Watcher
+{
+	int fd;
+	const char *game_path;
+	char **paths; // directory path by watch descriptor, with a trailing separator (empty for the current directory)
+	size_t paths_size;
+};
+
+volatile sig_atomic_t stop_requested = 0; // set by SIGINT/SIGTERM in the long-running modes
+
+void request_stop(int signal_number)
+{
+	(void) signal_number;
+	stop_requested = 1;
+}
+
+void install_stop_handlers()
+{
+	struct sigaction action;
+
+	// No SA_RESTART, so poll returns when a signal arrives
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = request_stop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+}
+
+/** Returns a newly allocated parent + name, with a trailing separator unless it's empty */
+char *make_directory_path(const char *parent, const char *name)
+{
+	size_t parent_length = strlen(parent);
+	size_t name_length = strlen(name);
+	char *result = (char *) malloc(sizeof(char) * (parent_length + name_length + 2));
+
+	memcpy(result, parent, parent_length);
+	memcpy(result + parent_length, name, name_length);
+	parent_length += name_length;
+	if (parent_length != 0 && result[parent_length - 1] != '\\' && result[parent_length - 1] != '/')
+		result[parent_length++] = PATH_SEPARATOR;
+	result[parent_length] = '\0';
+
+	return result;
+}
+
+void watch_directory_tree(struct Game_Watcher *watcher, const char *path)
+{
+	DIR *directory;
+	struct dirent *file_data;
+	struct stat file_stat;
+	char *child;
+	int wd;
+
+	wd = inotify_add_watch(watcher->fd, *path == '\0' ? "." : path, GAME_WATCHER_EVENTS);
+	stat_add(stat_syscalls, 1);
+	if (wd < 0)
+	{
+		printf("ERROR: Unable to watch %s\n", path);
+		return;
+	}
+
+	if ((size_t) wd >= watcher->paths_size)
+	{
+		watcher->paths = (char **) realloc(watcher->paths, sizeof(char *) * (wd + 64));
+		memset(watcher->paths + watcher->paths_size, 0, sizeof(char *) * (wd + 64 - watcher->paths_size));
+		watcher->paths_size = wd + 64;
+	}
+	free(watcher->paths[wd]); // the same directory reached through another path
+	watcher->paths[wd] = strdup(path);
+
+	directory = opendir(*path == '\0' ? "." : path);
+	if (directory == NULL)
+		return;
+
+	while ((file_data = readdir(directory)) != NULL)
+	{
+		// Same rules as the crawler: no hidden directories, no directory symlinks
+		if (file_data->d_name[0] == '.')
+			continue;
+		if (file_data->d_type != DT_DIR && (file_data->d_type != DT_UNKNOWN || fstatat(dirfd(directory), file_data->d_name, &file_stat, AT_SYMLINK_NOFOLLOW) != 0 || S_ISDIR(file_stat.st_mode) == false))
+			continue;
+
+		child = make_directory_path(path, file_data->d_name);
+		watch_directory_tree(watcher, child);
+		free(child);
+	}
+
+	closedir(directory);
+}
+
+/** Removes the watches on path and everything below it; their paths are released when IN_IGNORED arrives */
+void unwatch_directory_tree(struct Game_Watcher *watcher, const char *path)
+{
+	size_t path_length = strlen(path);
+	size_t wd;
+
+	for (wd = 0; wd != watcher->paths_size; ++wd)
+		if (watcher->paths[wd] != NULL && strncmp(watcher->paths[wd], path, path_length) == 0)
+			inotify_rm_watch(watcher->fd, (int) wd);
+}
+
+bool open_game_watcher(struct Game_Watcher *watcher, const char *game_path)
+{
+	char *root;
+
+	watcher->game_path = game_path;
+	watcher->paths = NULL;
+	watcher->paths_size = 0;
+	watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watcher->fd < 0)
+		return false;
+
+	root = make_directory_path("", game_path);
+	watch_directory_tree(watcher, root);
+	free(root);
+
+	return true;
+}
+
+void close_game_watcher(struct Game_Watcher *watcher)
+{
+	size_t wd;
+
+	for (wd = 0; wd != watcher->paths_size; ++wd)
+		free(watcher->paths[wd]);
+	free(watcher->paths);
+	watcher->paths = NULL;
+	watcher->paths_size = 0;
+
+	if (watcher->fd >= 0)
+		close(watcher->fd);
+	watcher->fd = -1;
+}
+
+/** Applies every queued event; returns true if the game package table changed */
+bool process_game_watcher_events(struct Game_Watcher *watcher)
+{
+	char buffer[65536] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *event;
+	ssize_t length;
+	ssize_t offset;
+	size_t table_size;
+	bool overflow = false;
+	bool changed = false;
+	const char *directory;
+	char *path;
+
+	while ((length = read(watcher->fd, buffer, sizeof(buffer))) > 0)
+	{
+		stat_add(stat_syscalls, 1);
+		for (offset = 0; offset < length; offset += sizeof(struct inotify_event) + event->len)
+		{
+			event = (const struct inotify_event *) (buffer + offset);
+
+			if (event->mask & IN_Q_OVERFLOW)
+				overflow = true;
+			if (event->wd < 0 || (size_t) event->wd >= watcher->paths_size || watcher->paths[event->wd] == NULL)
+				continue;
+
+			directory = watcher->paths[event->wd];
+			if (event->mask & IN_IGNORED)
+			{
+				free(watcher->paths[event->wd]);
+				watcher->paths[event->wd] = NULL;
+				continue;
+			}
+
+			if (event->len == 0 || event->name[0] == '\0')
+				continue;
+
+			if (event->mask & IN_ISDIR)
+			{
+				if (event->name[0] == '.')
+					continue;
+
+				path = make_directory_path(directory, event->name);
+				if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+				{
+					if (event->mask & IN_MOVED_FROM)
+						unwatch_directory_tree(watcher, path);
+					changed |= remove_game_packages(path, true) != 0;
+				}
+				else if (event->mask & (IN_CREATE | IN_MOVED_TO))
+				{
+					// Watch first so nothing written after the crawl is missed
+					watch_directory_tree(watcher, path);
+					table_size = game_package_table_size;
+					build_game_package_table(path);
+					changed |= game_package_table_size != table_size;
+				}
+				free(path);
+			}
+			else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+				changed |= update_game_package(directory, event->name);
+			else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+			{
+				path = (char *) malloc(sizeof(char) * (strlen(directory) + strlen(event->name) + 1));
+				sprintf(path, "%s%s", directory, event->name);
+				changed |= remove_game_packages(path, false) != 0;
+				free(path);
+			}
+		}
+	}
+
+	if (overflow)
+	{
+		// Events were lost; start again from what's on disk
+		puts("ERROR: Game directory events overflowed; rebuilding the game package table.");
+		close_game_watcher(watcher);
+		open_game_watcher(watcher, watcher->game_path);
+		free_game_package_table();
+		build_game_package_table(watcher->game_path);
+		changed = true;
+	}
+
+	if (changed)
+		build_game_package_index();
+
+	return changed;
+}
+
+#endif // __linux__
+
+/** Dependency Graph Functions */
+
+/** One package in the transitive closure; resolved packages are keyed by GUID, unresolved ones by name */
+struct Dependency_Node
+{
+	struct UDKPackage *package;
+	bool against; // in the against list; neither shipped nor descended into
+	int mark; // topological sort state: 0 = unvisited, 1 = on stack, 2 = emitted
+
+	struct Dependency_Node **imports;
+	size_t imports_size;
+	size_t imports_capacity;
+};
+
+bool transitive_dependencies = false;
+mutex_t dependency_graph_lock;
+struct Dependency_Node **dependency_graph = NULL;
+size_t dependency_graph_size = 0;
+size_t dependency_graph_mask = 0;
+
+/** Packages discovered through other packages; kept until free_package since the dependency list points into them */
+struct UDKPackage **transitive_package_table = NULL;
+size_t transitive_package_table_size = 0;
+size_t transitive_package_table_capacity = 0;
+
+bool is_same_package(const struct UDKPackage *lhs, const struct UDKPackage *rhs)
+{
+	if ((lhs->filename != NULL) != (rhs->filename != NULL))
+		return false;
+	if (lhs->filename != NULL)
+		return memcmp(lhs->GUID, rhs->GUID, sizeof(lhs->GUID)) == 0;
+	return strcmpi(get_package_name(lhs), get_package_name(rhs)) == 0;
+}
+
+uint32_t dependency_node_hash(const struct UDKPackage *package)
+{
+	if (package->filename != NULL)
+		return guid_hash(package->GUID);
+	return name_hash(get_package_name(package), NULL);
+}
+
+void free_dependency_graph()
+{
+	size_t slot;
+
+	if (dependency_graph == NULL)
+		return;
+
+	for (slot = 0; slot <= dependency_graph_mask; ++slot)
+		if (dependency_graph[slot] != NULL)
+		{
+			free(dependency_graph[slot]->imports);
+			free(dependency_graph[slot]);
+		}
+
+	free(dependency_graph);
+	dependency_graph = NULL;
+	dependency_graph_size = 0;
+	dependency_graph_mask = 0;
+}
+
+void free_transitive_package_table()
+{
+	size_t index;
+
+	for (index = 0; index != transitive_package_table_size; ++index)
+	{
+		free(transitive_package_table[index]->filename);
+		free(transitive_package_table[index]->name);
+		free(transitive_package_table[index]);
+	}
+
+	free(transitive_package_table);
+	transitive_package_table = NULL;
+	transitive_package_table_size = 0;
+	transitive_package_table_capacity = 0;
+}
+
+void place_dependency_node(struct Dependency_Node **graph, size_t mask, struct Dependency_Node *node)
+{
+	size_t slot;
+
+	for (slot = dependency_node_hash(node->package) & mask; graph[slot] != NULL; slot = (slot + 1) & mask);
+	graph[slot] = node;
+}
+
+/** Inserts a node into the graph's open-addressed table, growing it to stay under half full; caller holds dependency_graph_lock */
+void insert_dependency_node(struct Dependency_Node *node)
+{
+	struct Dependency_Node **graph;
+	size_t mask;
+	size_t slot;
+
+	if ((dependency_graph_size + 1) * 2 > dependency_graph_mask)
+	{
+		mask = dependency_graph == NULL ? 63 : dependency_graph_mask * 2 + 1;
+		graph = (struct Dependency_Node **) calloc(mask + 1, sizeof(struct Dependency_Node *));
+
+		if (dependency_graph != NULL)
+		{
+			for (slot = 0; slot <= dependency_graph_mask; ++slot)
+				if (dependency_graph[slot] != NULL)
+					place_dependency_node(graph, mask, dependency_graph[slot]);
+			free(dependency_graph);
+		}
+
+		dependency_graph = graph;
+		dependency_graph_mask = mask;
+	}
+
+	place_dependency_node(dependency_graph, dependency_graph_mask, node);
+	++dependency_graph_size;
+}
+
+/** Returns the node for a package, creating it if this is the first time it has been seen; caller holds dependency_graph_lock */
+struct Dependency_Node *get_dependency_node(struct UDKPackage *package, bool *created)
+{
+	struct Dependency_Node *node;
+	size_t slot;
+
+	*created = false;
+	if (dependency_graph != NULL)
+		for (slot = dependency_node_hash(package) & dependency_graph_mask; dependency_graph[slot] != NULL; slot = (slot + 1) & dependency_graph_mask)
+			if (is_same_package(dependency_graph[slot]->package, package))
+				return dependency_graph[slot];
+
+	node = (struct Dependency_Node *) calloc(1, sizeof(struct Dependency_Node));
+	node->package = package;
+	node->against = package->filename != NULL && is_in_against_list(package->GUID);
+	insert_dependency_node(node);
+
+	*created = true;
+	return node;
+}
+
+void add_transitive_package(struct UDKPackage *package)
+{
+	if (transitive_package_table_size == transitive_package_table_capacity)
+	{
+		transitive_package_table_capacity = transitive_package_table_capacity == 0 ? 64 : transitive_package_table_capacity * 2;
+		transitive_package_table = (struct UDKPackage **) realloc(transitive_package_table, sizeof(struct UDKPackage *) * transitive_package_table_capacity);
+	}
+	transitive_package_table[transitive_package_table_size++] = package;
+}
+
+void parse_dependency_node(struct Work_Pool *pool, size_t worker, void *data);
+
+/** Records that parent imports package, and queues package to be parsed if nobody has claimed it yet */
+void add_dependency_edge(struct Work_Pool *pool, size_t worker, struct Dependency_Node *parent, struct UDKPackage *package, bool transitive)
+{
+	struct Dependency_Node *node;
+	bool created;
+
+	mutex_lock(&dependency_graph_lock);
+	node = get_dependency_node(package, &created);
+	if (created && transitive)
+		add_transitive_package(package);
+
+	if (parent->imports_size == parent->imports_capacity)
+	{
+		parent->imports_capacity = parent->imports_capacity == 0 ? 8 : parent->imports_capacity * 2;
+		parent->imports = (struct Dependency_Node **) realloc(parent->imports, sizeof(struct Dependency_Node *) * parent->imports_capacity);
+	}
+	parent->imports[parent->imports_size++] = node;
+	mutex_unlock(&dependency_graph_lock);
+
+	if (created == false && transitive)
+	{
+		free(package->filename);
+		free(package->name);
+		free(package);
+	}
+
+	if (created && node->against == false && node->package->filename != NULL)
+		work_pool_push(pool, worker, parse_dependency_node, node);
+}
+
+/** Parses a dependency's own imports without touching the base package's globals */
+void parse_dependency_node(struct Work_Pool *pool, size_t worker, void *data)
+{
+	struct Dependency_Node *node = (struct Dependency_Node *) data;
+	struct UDKPackage_File file;
+	struct UDKImport import;
+	struct UDKPackage_Game *game_package;
+	struct UDKPackage *package;
+	const char *name;
+	int32_t length;
+	uint32_t index;
+
+	if (open_package_file(&file, node->package->filename) == false)
+	{
+		printf("ERROR: Unable to read dependency %s\n", node->package->filename);
+		return;
+	}
+
+	for (index = 0; index != file.summary.import_count; ++index)
+	{
+		get_import(&file, index, &import);
+
+		// Only packages; names that are UTF-16 or missing can't be package names on disk
+		if (import.package_reference != 0 || get_package_file_name(&file, import.object_name_index, &name, &length) == false || length <= 1)
+			continue;
+
+		package = (struct UDKPackage *) malloc(sizeof(struct UDKPackage));
+		package->name_index = INVALID_NAME;
+		package->name = strdup(name);
+
+		game_package = find_game_package(name, name + length - 1);
+		if (game_package != NULL)
+		{
+			package->filename = strdup(game_package->filename);
+			package->extension = game_package->extension;
+			memcpy(package->GUID, game_package->GUID, sizeof(package->GUID));
+		}
+		else
+		{
+			package->filename = NULL;
+			package->extension = ext_UNKNOWN;
+			memset(package->GUID, 0, sizeof(package->GUID));
+		}
+
+		add_dependency_edge(pool, worker, node, package, true);
+	}
+
+	close_package_file(&file);
+}
+
+/** Emits nodes reachable from root so that every package comes after the packages it imports; cycles are broken at the back edge */
+void sort_dependency_graph(struct Dependency_Node *root)
+{
+	struct Dependency_Node **stack = (struct Dependency_Node **) malloc(sizeof(struct Dependency_Node *) * (dependency_graph_size + 1));
+	size_t *positions = (size_t *) malloc(sizeof(size_t) * (dependency_graph_size + 1));
+	size_t depth = 0;
+	struct Dependency_Node *node;
+
+	stack[0] = root;
+	positions[0] = 0;
+	root->mark = 1;
+
+	while (depth != SIZE_MAX)
+	{
+		node = stack[depth];
+		if (positions[depth] == node->imports_size)
+		{
+			node->mark = 2;
+			if (node != root)
+				append_dependency(node->package);
+			--depth;
+			continue;
+		}
+
+		node = node->imports[positions[depth]++];
+		if (node->mark == 0 && node->against == false)
+		{
+			node->mark = 1;
+			stack[++depth] = node;
+			positions[depth] = 0;
+		}
+	}
+
+	free(stack);
+	free(positions);
+}
+
+/** Builds the dependency list from the full import closure of the base package; requires the game package index */
+void build_dependency_graph()
+{
+	struct Work_Pool *pool = get_work_pool();
+	struct Dependency_Node root;
+	size_t index;
+
+	memset(&root, 0, sizeof(root));
+	mutex_init(&dependency_graph_lock);
+
+	for (index = 0; index != packages_imported; ++index)
+		add_dependency_edge(pool, SIZE_MAX, &root, &package_table[index], false);
+	work_pool_wait(pool);
+
+	sort_dependency_graph(&root);
+
+	free(root.imports);
+	free_dependency_graph();
+	mutex_destroy(&dependency_graph_lock);
+}
+
+/** Copy Engine */
+
+bool copy_hardlinks = false; // link packages into the output instead of copying them where possible
+
+struct Copy_Job
+{
+	char *source;
+	char *destination;
+};
+
+mutex_t copy_lock;
+size_t copy_failures = 0;
+
+bool make_directory(const char *path)
+{
+#if defined _WIN32
+	return CreateDirectory(path, NULL) != FALSE || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+	return mkdir(path, 0777) == 0 || errno == EEXIST;
+#endif // _WIN32
+}
+
+/** Copies source to destination, preferring a reflink, then in-kernel copies, then read/write */
+bool copy_file(const char *source, const char *destination)
+{
+#if defined _WIN32
+	uint64_t size;
+	int64_t mtime;
+
+	if (copy_hardlinks)
+	{
+		DeleteFile(destination);
+		stat_add(stat_syscalls, 2);
+		if (CreateHardLink(destination, source, NULL) != FALSE)
+			return true;
+	}
+
+	stat_add(stat_syscalls, 1);
+	if (CopyFile(source, destination, FALSE) == FALSE)
+		return false;
+
+	stat_add(stat_files_opened, 2);
+	if (stat_counters != NULL && stat_file(CURRENT_DIRECTORY_FD, destination, &size, &mtime))
+		stat_add(stat_bytes_written, size);
+	return true;
+#else
+	int in_fd;
+	int out_fd;
+	struct stat file_stat;
+	off_t offset = 0;
+	ssize_t length = 0;
+	char buffer[65536];
+	ssize_t written;
+	ssize_t count;
+	bool result;
+
+	if (copy_hardlinks)
+	{
+		unlink(destination);
+		stat_add(stat_syscalls, 2);
+		if (link(source, destination) == 0)
+			return true;
+	}
+
+	in_fd = open(source, O_RDONLY | O_CLOEXEC);
+	stat_add(stat_syscalls, 1);
+	if (in_fd < 0)
+		return false;
+	stat_add(stat_files_opened, 1);
+
+	stat_add(stat_syscalls, 2); // fstat, and close at the end
+	if (fstat(in_fd, &file_stat) != 0)
+	{
+		close(in_fd);
+		return false;
+	}
+
+	out_fd = open(destination, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	stat_add(stat_syscalls, 1);
+	if (out_fd < 0)
+	{
+		close(in_fd);
+		return false;
+	}
+	stat_add(stat_files_opened, 1);
+	stat_add(stat_syscalls, 1); // close at the end
+
+#if defined FICLONE
+	// Share extents on copy-on-write filesystems
+	stat_add(stat_syscalls, 1);
+	if (ioctl(out_fd, FICLONE, in_fd) == 0)
+		offset = file_stat.st_size;
+#endif // FICLONE
+
+#if defined SYS_copy_file_range
+	while (offset < file_stat.st_size && (length = syscall(SYS_copy_file_range, in_fd, &offset, out_fd, NULL, (size_t) (file_stat.st_size - offset), 0)) > 0)
+		stat_add(stat_syscalls, 1);
+#endif // SYS_copy_file_range
+
+#if defined __linux__
+	// copy_file_range is unavailable across filesystems on older kernels
+	while (offset < file_stat.st_size && (length = sendfile(out_fd, in_fd, &offset, (size_t) (file_stat.st_size - offset))) > 0)
+		stat_add(stat_syscalls, 1);
+#endif // __linux__
+
+	while (offset < file_stat.st_size && (length = pread(in_fd, buffer, sizeof(buffer), offset)) > 0)
+	{
+		stat_add(stat_syscalls, 1);
+		stat_add(stat_bytes_read, length);
+		for (written = 0; written != length; written += count)
+		{
+			count = write(out_fd, buffer + written, length - written);
+			stat_add(stat_syscalls, 1);
+			if (count <= 0)
+				break;
+		}
+
+		if (written != length)
+			break;
+		offset += length;
+	}
+
+	stat_add(stat_bytes_written, offset);
+	result = offset == file_stat.st_size;
+	close(in_fd);
+	return close(out_fd) == 0 && result;
+#endif // _WIN32
+}
+
+void copy_task(struct Work_Pool *pool, size_t worker, void *data)
+{
+	struct Copy_Job *job = (struct Copy_Job *) data;
+
+	(void) pool, (void) worker;
+
+	if (copy_file(job->source, job->destination) == false)
+	{
+		printf("ERROR: Unable to copy %s to %s\n", job->source, job->destination);
+
+		mutex_lock(&copy_lock);
+		++copy_failures;
+		mutex_unlock(&copy_lock);
+	}
+
+	free(job->source);
+	free(job->destination);
+	free(job);
+}
+
+/** Queues a copy on the work pool; wait with work_pool_wait */
+void queue_copy(const char *source, const char *destination)
+{
+	struct Copy_Job *job = (struct Copy_Job *) malloc(sizeof(struct Copy_Job));
+
+	job->source = strdup(source);
+	job->destination = strdup(destination);
+	work_pool_push(get_work_pool(), SIZE_MAX, copy_task, job);
+}
+
+/** Archive Output */
+
+/**
+ * Streams package files into a single ustar archive instead of a directory tree. The tar stream is cut into fixed-size
+ * chunks; with compression each chunk is deflated on the work pool as an independent gzip member (a valid .tar.gz once
+ * concatenated), and at most ARCHIVE_CHUNKS_IN_FLIGHT chunks exist at a time so memory use doesn't grow with package size.
+ */
+
+#define ARCHIVE_CHUNK_SIZE (1 << 20)
+#define ARCHIVE_CHUNKS_IN_FLIGHT 8
+#define TAR_BLOCK_SIZE 512
+
+bool archive_output = false; // -package writes <GUID>.tar rather than a directory tree
+int archive_compression = 0; // deflate level; 0 = store
+
+struct Archive_Chunk
+{
+	uint8_t *data;
+	size_t size;
+	uint8_t *output; // compressed data
+	size_t output_size;
+	bool done;
+	struct Archive *archive;
+};
+
+struct Archive
+{
+	FILE *file;
+	int compression;
+	struct Archive_Chunk chunks[ARCHIVE_CHUNKS_IN_FLIGHT];
+	size_t head; // oldest chunk in flight
+	size_t in_flight;
+	size_t current; // chunk being filled
+	bool failed;
+
+	mutex_t lock;
+	cond_t chunk_done;
+};
+
+#if defined HAVE_ZLIB
+
+void compress_archive_chunk(struct Work_Pool *pool, size_t worker, void *data)
+{
+	struct Archive_Chunk *chunk = (struct Archive_Chunk *) data;
+	z_stream stream;
+	bool result;
+
+	(void) pool, (void) worker;
+
+	memset(&stream, 0, sizeof(stream));
+	result = deflateInit2(&stream, chunk->archive->compression, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+	if (result)
+	{
+		stream.next_in = chunk->data;
+		stream.avail_in = (uInt) chunk->size;
+		stream.next_out = chunk->output;
+		stream.avail_out = (uInt) deflateBound(&stream, ARCHIVE_CHUNK_SIZE);
+		result = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+		chunk->output_size = stream.total_out;
+		deflateEnd(&stream);
+	}
+
+	mutex_lock(&chunk->archive->lock);
+	if (result == false)
+		chunk->archive->failed = true;
+	chunk->done = true;
+	cond_broadcast(&chunk->archive->chunk_done);
+	mutex_unlock(&chunk->archive->lock);
+}
+
+#endif // HAVE_ZLIB
+
+/** Waits for the oldest chunk in flight and writes it out */
+void retire_archive_chunk(struct Archive *archive)
+{
+	struct Archive_Chunk *chunk = &archive->chunks[archive->head];
+
+	mutex_lock(&archive->lock);
+	while (chunk->done == false)
+		cond_wait(&archive->chunk_done, &archive->lock);
+	mutex_unlock(&archive->lock);
+
+	if (fwrite(chunk->output, sizeof(uint8_t), chunk->output_size, archive->file) != chunk->output_size)
+		archive->failed = true;
+	stat_add(stat_bytes_written, chunk->output_size);
+	stat_add(stat_syscalls, 1);
+
+	chunk->size = 0;
+	archive->head = (archive->head + 1) % ARCHIVE_CHUNKS_IN_FLIGHT;
+	--archive->in_flight;
+}
+
+/** Hands the current chunk off for compression (or writes it directly when storing) and moves to the next one */
+void submit_archive_chunk(struct Archive *archive)
+{
+	struct Archive_Chunk *chunk = &archive->chunks[archive->current];
+
+	if (chunk->size == 0)
+		return;
+
+	if (archive->compression == 0)
+	{
+		if (fwrite(chunk->data, sizeof(uint8_t), chunk->size, archive->file) != chunk->size)
+			archive->failed = true;
+		stat_add(stat_bytes_written, chunk->size);
+		stat_add(stat_syscalls, 1);
+		chunk->size = 0;
+		return;
+	}
+
+	chunk->done = false;
+	++archive->in_flight;
+	archive->current = (archive->current + 1) % ARCHIVE_CHUNKS_IN_FLIGHT;
+#if defined HAVE_ZLIB
+	work_pool_push(get_work_pool(), SIZE_MAX, compress_archive_chunk, chunk);
+#endif // HAVE_ZLIB
+
+	// Bound memory: the next chunk to fill must be free
+	if (archive->in_flight == ARCHIVE_CHUNKS_IN_FLIGHT)
+		retire_archive_chunk(archive);
+}
+
+/** Returns where the next length bytes (at most) of the tar stream go; the caller reports how many it used with commit_archive_space */
+uint8_t *reserve_archive_space(struct Archive *archive, size_t *length)
+{
+	struct Archive_Chunk *chunk = &archive->chunks[archive->current];
+
+	if (chunk->size == ARCHIVE_CHUNK_SIZE)
+	{
+		submit_archive_chunk(archive);
+		chunk = &archive->chunks[archive->current];
+	}
+
+	if (*length > ARCHIVE_CHUNK_SIZE - chunk->size)
+		*length = ARCHIVE_CHUNK_SIZE - chunk->size;
+
+	return chunk->data + chunk->size;
+}
+
+void commit_archive_space(struct Archive *archive, size_t length)
+{
+	archive->chunks[archive->current].size += length;
+}
+
+void write_archive(struct Archive *archive, const void *data, size_t size)
+{
+	size_t length;
+	uint8_t *space;
+
+	while (size != 0)
+	{
+		length = size;
+		space = reserve_archive_space(archive, &length);
+		memcpy(space, data, length);
+		commit_archive_space(archive, length);
+
+		data = (const uint8_t *) data + length;
+		size -= length;
+	}
+}
+
+void write_archive_padding(struct Archive *archive, size_t size)
+{
+	static const uint8_t zeros[TAR_BLOCK_SIZE] = { 0 };
+
+	while (size > TAR_BLOCK_SIZE)
+	{
+		write_archive(archive, zeros, TAR_BLOCK_SIZE);
+		size -= TAR_BLOCK_SIZE;
+	}
+	write_archive(archive, zeros, size);
+}
+
+/** Writes value as a null-terminated octal field, or base-256 if it doesn't fit */
+void write_tar_number(char *field, size_t field_size, uint64_t value)
+{
+	size_t index;
+
+	if (value < (uint64_t) 1 << (3 * (field_size - 1)))
+	{
+		field[field_size - 1] = '\0';
+		for (index = field_size - 1; index != 0; --index, value >>= 3)
+			field[index - 1] = '0' + (char) (value & 7);
+		return;
+	}
+
+	for (index = field_size; index != 0; --index, value >>= 8)
+		field[index - 1] = (char) (value & 0xFF);
+	field[0] = (char) 0x80;
+}
+
+bool write_tar_header(struct Archive *archive, const char *path, uint64_t size, uint64_t mtime)
+{
+	uint8_t header[TAR_BLOCK_SIZE];
+	size_t path_length = strlen(path);
+	const char *split = NULL;
+	uint32_t checksum = 0;
+	size_t index;
+
+	memset(header, 0, sizeof(header));
+
+	// Names over 100 characters are split into prefix and name at a '/'
+	if (path_length > 100)
+	{
+		for (split = path + path_length - 1; split != path; --split)
+			if (*split == '/' && split - path <= 155 && path_length - (split - path) - 1 <= 100)
+				break;
+
+		if (split == path)
+			return false;
+
+		memcpy(header + 345, path, split - path);
+		memcpy(header, split + 1, path_length - (split - path) - 1);
+	}
+	else
+		memcpy(header, path, path_length);
+
+	write_tar_number((char *) header + 100, 8, 0644);
+	write_tar_number((char *) header + 108, 8, 0);
+	write_tar_number((char *) header + 116, 8, 0);
+	write_tar_number((char *) header + 124, 12, size);
+	write_tar_number((char *) header + 136, 12, mtime);
+	header[156] = '0';
+	memcpy(header + 257, "ustar", 6);
+	memcpy(header + 263, "00", 2);
+
+	// checksum is computed with its own field as spaces
+	memset(header + 148, ' ', 8);
+	for (index = 0; index != TAR_BLOCK_SIZE; ++index)
+		checksum += header[index];
+	write_tar_number((char *) header + 148, 7, checksum);
+	header[155] = ' ';
+
+	write_archive(archive, header, sizeof(header));
+	return true;
+}
+
+/** Streams one file into the archive as path */
+bool add_archive_file(struct Archive *archive, const char *source, const char *path)
+{
+	FILE *file;
+	uint64_t size;
+	int64_t mtime;
+	uint64_t remaining;
+	size_t length;
+	size_t count;
+	uint8_t *space;
+
+	if (stat_file(CURRENT_DIRECTORY_FD, source, &size, &mtime) == false)
+		return false;
+
+	file = fopen(source, "rb");
+	stat_add(stat_syscalls, 2); // open, close
+	if (file == NULL)
+		return false;
+	stat_add(stat_files_opened, 1);
+
+#if defined _WIN32
+	mtime = mtime / 10000000 - 11644473600LL; // FILETIME to Unix time
+#else
+	mtime /= 1000000000;
+#endif // _WIN32
+
+	if (write_tar_header(archive, path, size, mtime < 0 ? 0 : (uint64_t) mtime) == false)
+	{
+		fclose(file);
+		return false;
+	}
+
+	// read straight into the archive's chunk buffers
+	for (remaining = size; remaining != 0; remaining -= count)
+	{
+		length = remaining > ARCHIVE_CHUNK_SIZE ? ARCHIVE_CHUNK_SIZE : (size_t) remaining;
+		space = reserve_archive_space(archive, &length);
+		count = fread(space, sizeof(uint8_t), length, file);
+		commit_archive_space(archive, count);
+		stat_add(stat_bytes_read, count);
+		stat_add(stat_syscalls, 1);
+
+		if (count != length)
+		{
+			// the file shrank; pad so the archive stays consistent
+			write_archive_padding(archive, (size_t) (remaining - count));
+			archive->failed = true;
+			break;
+		}
+	}
+
+	write_archive_padding(archive, (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE);
+	fclose(file);
+	return true;
+}
+
+bool open_archive(struct Archive *archive, const char *filename, int compression)
+{
+	size_t index;
+
+	archive->file = fopen(filename, "wb");
+	if (archive->file == NULL)
+		return false;
+	stat_add(stat_files_opened, 1);
+
+#if !defined HAVE_ZLIB
+	compression = 0;
+#endif // HAVE_ZLIB
+
+	archive->compression = compression;
+	archive->head = 0;
+	archive->in_flight = 0;
+	archive->current = 0;
+	archive->failed = false;
+	mutex_init(&archive->lock);
+	cond_init(&archive->chunk_done);
+
+	for (index = 0; index != ARCHIVE_CHUNKS_IN_FLIGHT; ++index)
+	{
+		archive->chunks[index].data = (uint8_t *) malloc(ARCHIVE_CHUNK_SIZE);
+		archive->chunks[index].size = 0;
+		archive->chunks[index].output = NULL;
+		archive->chunks[index].output_size = 0;
+		archive->chunks[index].done = true;
+		archive->chunks[index].archive = archive;
+#if defined HAVE_ZLIB
+		if (compression != 0)
+			archive->chunks[index].output = (uint8_t *) malloc(compressBound(ARCHIVE_CHUNK_SIZE) + 32);
+#endif // HAVE_ZLIB
+
+		if (compression == 0)
+			break; // storing only ever uses the first chunk
+	}
+
+	return true;
+}
+
+/** Ends the tar stream, drains the pipeline and closes the file; returns false if anything failed */
+bool close_archive(struct Archive *archive)
+{
+	size_t index;
+	bool result;
+
+	write_archive_padding(archive, TAR_BLOCK_SIZE * 2);
+	submit_archive_chunk(archive);
+	while (archive->in_flight != 0)
+		retire_archive_chunk(archive);
+
+	result = archive->failed == false;
+	result = fclose(archive->file) == 0 && result;
+
+	for (index = 0; index != ARCHIVE_CHUNKS_IN_FLIGHT; ++index)
+	{
+		free(archive->chunks[index].data);
+		free(archive->chunks[index].output);
+		if (archive->compression == 0)
+			break;
+	}
+
+	mutex_destroy(&archive->lock);
+	cond_destroy(&archive->chunk_done);
+	return result;
+}
+
+/** Content Store */
+
+/**
+ * Stores each package file once, as a blob named by the hash of its contents, so maps that share dependencies share
+ * storage. Files are hashed in STORE_CHUNK_SIZE chunks on the work pool (XXH64 per chunk, then XXH64 over the chunk
+ * hashes seeded with the file size); whichever chunk finishes last files the blob. Per map, only a manifest is written:
+ *
+ * RXMANIFEST 1
+ * <16 hex digit hash> <size> <path within the package>
+ */
+
+#define STORE_CHUNK_SIZE (4 << 20)
+#define STORE_MANIFEST_VERSION 1
+
+const char *store_directory = NULL; // -package writes blobs here and a <GUID>.manifest instead of a tree
+
+struct Store_File
+{
+	struct Mapped_File file;
+	char *source;
+	char *path;
+	uint64_t size;
+	uint64_t *chunk_hashes;
+	struct Store_Chunk *chunks;
+	size_t chunk_count;
+	size_t chunks_remaining;
+	uint64_t hash;
+	bool failed;
+	struct Store *store;
+};
+
+struct Store_Chunk
+{
+	struct Store_File *file;
+	size_t index;
+};
+
+struct Store
+{
+	const char *directory;
+	struct Store_File **files;
+	size_t files_size;
+	size_t files_capacity;
+	size_t temporary_count; // makes temporary blob names unique within this process
+
+	mutex_t lock;
+};
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+uint64_t read_uint64(const uint8_t *data)
+{
+	uint64_t result;
+
+	memcpy(&result, data, sizeof(result));
+	return result;
+}
+
+uint64_t rotate_left_64(uint64_t value, int amount)
+{
+	return (value << amount) | (value >> (64 - amount));
+}
+
+uint64_t xxh64_round(uint64_t accumulator, uint64_t input)
+{
+	accumulator += input * XXH_PRIME64_2;
+	return rotate_left_64(accumulator, 31) * XXH_PRIME64_1;
+}
+
+uint64_t xxh64_merge_round(uint64_t accumulator, uint64_t value)
+{
+	accumulator ^= xxh64_round(0, value);
+	return accumulator * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+/** XXH64; the four independent lanes keep the main loop free of dependency chains */
+uint64_t xxh64(const uint8_t *data, size_t size, uint64_t seed)
+{
+	const uint8_t *end = data + size;
+	uint64_t lanes[4];
+	uint64_t result;
+
+	if (size >= 32)
+	{
+		lanes[0] = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+		lanes[1] = seed + XXH_PRIME64_2;
+		lanes[2] = seed;
+		lanes[3] = seed - XXH_PRIME64_1;
+
+		do
+		{
+			lanes[0] = xxh64_round(lanes[0], read_uint64(data));
+			lanes[1] = xxh64_round(lanes[1], read_uint64(data + 8));
+			lanes[2] = xxh64_round(lanes[2], read_uint64(data + 16));
+			lanes[3] = xxh64_round(lanes[3], read_uint64(data + 24));
+			data += 32;
+		} while (end - data >= 32);
+
+		result = rotate_left_64(lanes[0], 1) + rotate_left_64(lanes[1], 7) + rotate_left_64(lanes[2], 12) + rotate_left_64(lanes[3], 18);
+		result = xxh64_merge_round(result, lanes[0]);
+		result = xxh64_merge_round(result, lanes[1]);
+		result = xxh64_merge_round(result, lanes[2]);
+		result = xxh64_merge_round(result, lanes[3]);
+	}
+	else
+		result = seed + XXH_PRIME64_5;
+
+	result += (uint64_t) size;
+
+	for (; end - data >= 8; data += 8)
+		result = rotate_left_64(result ^ xxh64_round(0, read_uint64(data)), 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+
+	if (end - data >= 4)
+	{
+		result = rotate_left_64(result ^ (uint64_t) read_uint32(data) * XXH_PRIME64_1, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		data += 4;
+	}
+
+	for (; data != end; ++data)
+		result = rotate_left_64(result ^ *data * XXH_PRIME64_5, 11) * XXH_PRIME64_1;
+
+	result ^= result >> 33;
+	result *= XXH_PRIME64_2;
+	result ^= result >> 29;
+	result *= XXH_PRIME64_3;
+	result ^= result >> 32;
+	return result;
+}
+
+unsigned long get_process_id()
+{
+#if defined _WIN32
+	return GetCurrentProcessId();
+#else
+	return (unsigned long) getpid();
+#endif // _WIN32
+}
+
+/** Copies a hashed file into the store unless a blob with its hash is already there */
+bool store_blob(struct Store_File *file)
+{
+	char blob[1024];
+	char tmp[1024 + 48];
+	size_t directory_length;
+	size_t temporary_index;
+	uint64_t size;
+	int64_t mtime;
+
+	directory_length = snprintf(blob, sizeof(blob), "%s%c%.2X", file->store->directory, PATH_SEPARATOR, (unsigned int) (file->hash >> 56));
+	snprintf(blob + directory_length, sizeof(blob) - directory_length, "%c%.16llX", PATH_SEPARATOR, (unsigned long long) file->hash);
+
+	if (stat_file(CURRENT_DIRECTORY_FD, blob, &size, &mtime))
+	{
+		if (size == file->size)
+			return true;
+
+		printf("ERROR: %s collides with a different blob in the store\n", file->source);
+		return false;
+	}
+
+	blob[directory_length] = '\0';
+	make_directory(blob);
+	blob[directory_length] = PATH_SEPARATOR;
+
+	// another map (or batch worker) may be storing the same blob; only whole blobs are ever renamed into place
+	mutex_lock(&file->store->lock);
+	temporary_index = file->store->temporary_count++;
+	mutex_unlock(&file->store->lock);
+	snprintf(tmp, sizeof(tmp), "%s.%lu.%lu.tmp", blob, get_process_id(), (unsigned long) temporary_index);
+
+	if (copy_file(file->source, tmp) == false)
+	{
+		remove(tmp);
+		return false;
+	}
+
+	stat_add(stat_syscalls, 1);
+	if (rename(tmp, blob) != 0)
+	{
+		remove(tmp);
+		return stat_file(CURRENT_DIRECTORY_FD, blob, &size, &mtime) && size == file->size;
+	}
+
+	return true;
+}
+
+void finish_store_file(struct Store_File *file)
+{
+	file->hash = xxh64((const uint8_t *) file->chunk_hashes, file->chunk_count * sizeof(uint64_t), file->size);
+	unmap_file(&file->file);
+
+	if (file->failed == false && store_blob(file) == false)
+	{
+		printf("ERROR: Unable to store %s\n", file->source);
+		file->failed = true;
+	}
+}
+
+void hash_store_chunk(struct Work_Pool *pool, size_t worker, void *data)
+{
+	struct Store_Chunk *chunk = (struct Store_Chunk *) data;
+	struct Store_File *file = chunk->file;
+	size_t offset = chunk->index * STORE_CHUNK_SIZE;
+	size_t length = file->file.size - offset < STORE_CHUNK_SIZE ? file->file.size - offset : STORE_CHUNK_SIZE;
+	bool last;
+
+	(void) pool, (void) worker;
+
+	file->chunk_hashes[chunk->index] = xxh64(file->file.data + offset, length, 0);
+
+	mutex_lock(&file->store->lock);
+	last = --file->chunks_remaining == 0;
+	mutex_unlock(&file->store->lock);
+
+	if (last)
+		finish_store_file(file);
+}
+
+void finish_empty_store_file(struct Work_Pool *pool, size_t worker, void *data)
+{
+	(void) pool, (void) worker;
+	finish_store_file((struct Store_File *) data);
+}
+
+void open_store(struct Store *store, const char *directory)
+{
+	store->directory = directory;
+	store->files = NULL;
+	store->files_size = 0;
+	store->files_capacity = 0;
+	store->temporary_count = 0;
+	mutex_init(&store->lock);
+
+	make_directory(directory);
+}
+
+/** Queues source to be hashed and stored; path is where the file belongs in the package */
+bool add_store_file(struct Store *store, const char *source, const char *path)
+{
+	struct Store_File *file;
+	int64_t mtime;
+	size_t index;
+
+	file = (struct Store_File *) calloc(1, sizeof(struct Store_File));
+	file->store = store;
+
+	if (stat_file(CURRENT_DIRECTORY_FD, source, &file->size, &mtime) == false
+		|| (file->size != 0 && map_file(&file->file, source) == false))
+	{
+		free(file);
+		return false;
+	}
+
+	file->source = strdup(source);
+	file->path = strdup(path);
+	file->chunk_count = (size_t) ((file->size + STORE_CHUNK_SIZE - 1) / STORE_CHUNK_SIZE);
+	file->chunks_remaining = file->chunk_count;
+	file->chunk_hashes = (uint64_t *) malloc(sizeof(uint64_t) * (file->chunk_count + 1));
+
+	if (store->files_size == store->files_capacity)
+	{
+		store->files_capacity = store->files_capacity == 0 ? 16 : store->files_capacity * 2;
+		store->files = (struct Store_File **) realloc(store->files, sizeof(struct Store_File *) * store->files_capacity);
+	}
+	store->files[store->files_size++] = file;
+
+	if (file->chunk_count == 0)
+	{
+		work_pool_push(get_work_pool(), SIZE_MAX, finish_empty_store_file, file);
+		return true;
+	}
+
+	file->chunks = (struct Store_Chunk *) malloc(sizeof(struct Store_Chunk) * file->chunk_count);
+	for (index = 0; index != file->chunk_count; ++index)
+	{
+		file->chunks[index].file = file;
+		file->chunks[index].index = index;
+		work_pool_push(get_work_pool(), SIZE_MAX, hash_store_chunk, &file->chunks[index]);
+	}
+
+	return true;
+}
+
+/** Writes the manifest for everything added since open_store; the work pool must be idle. Returns the number of files that failed */
+size_t close_store(struct Store *store, const char *manifest_filename)
+{
+	struct Store_File *file;
+	FILE *manifest;
+	size_t failures = 0;
+	size_t index;
+
+	manifest = fopen(manifest_filename, "wb");
+	if (manifest == NULL)
+	{
+		printf("ERROR: Unable to write %s\n", manifest_filename);
+		++failures;
+	}
+	else
+		fprintf(manifest, "RXMANIFEST %u\n", STORE_MANIFEST_VERSION);
+
+	for (index = 0; index != store->files_size; ++index)
+	{
+		file = store->files[index];
+		if (file->failed)
+			++failures;
+		else if (manifest != NULL)
+			fprintf(manifest, "%.16llX %llu %s\n", (unsigned long long) file->hash, (unsigned long long) file->size, file->path);
+
+		free(file->source);
+		free(file->path);
+		free(file->chunk_hashes);
+		free(file->chunks);
+		free(file);
+	}
+
+	if (manifest != NULL && fclose(manifest) != 0)
+		++failures;
+
+	free(store->files);
+	mutex_destroy(&store->lock);
+	return failures;
+}
+
+/** Packager */
+
+/** Copies source to destination, or streams it into the archive or store when one is open */
+void add_package_file(struct Archive *archive, struct Store *store, const char *source, const char *destination)
+{
+	if (store != NULL)
+	{
+		if (add_store_file(store, source, destination) == false)
+		{
+			printf("ERROR: Unable to store %s\n", source);
+			++copy_failures;
+		}
+		return;
+	}
+
+	if (archive == NULL)
+	{
+		queue_copy(source, destination);
+		return;
+	}
+
+	if (add_archive_file(archive, source, destination) == false)
+	{
+		printf("ERROR: Unable to archive %s\n", source);
+		++copy_failures;
+	}
+}
+
+/** Builds <GUID>/UDKGame/{Config,CookedPC/Custom_Content} from the base package and its dependencies, as a directory tree, a single archive or a manifest into the content store; returns false if anything failed to copy */
+bool generate_package(const char *game_path)
+{
+	uint32_t index;
+	char tmp[1024]; // 32 (directory) + 1 ('\') + 32 (filename) + 4 (".uxx") + 1 ('\0') = 70
+	char tmp2[1024];
+	size_t tmp_length = 0;
+	size_t failures = 0;
+	struct Archive archive;
+	struct Archive *output = NULL;
+	struct Store store;
+	struct Store *store_output = NULL;
+	char separator = PATH_SEPARATOR;
+
+	if (package_name == INVALID_NAME)
+	{
+		puts("ERROR: Package name not found in name table.");
+		return false;
+	}
+
+	mutex_init(&copy_lock);
+	copy_failures = 0;
+
+	if (archive_output)
+	{
+		sprintf(tmp, "%.8X%.8X%.8X%.8X.%s", package_GUID[0], package_GUID[1], package_GUID[2], package_GUID[3], archive_compression != 0 ? "tar.gz" : "tar");
+		if (open_archive(&archive, tmp, archive_compression) == false)
+		{
+			printf("ERROR: Unable to create %s\n", tmp);
+			mutex_destroy(&copy_lock);
+			return false;
+		}
+
+		output = &archive;
+		separator = '/'; // tar paths
+	}
+	else if (store_directory != NULL)
+	{
+		open_store(&store, store_directory);
+		store_output = &store;
+		separator = '/'; // manifest paths
+	}
+
+	tmp_length = sprintf(tmp, "%.8X%.8X%.8X%.8X", package_GUID[0], package_GUID[1], package_GUID[2], package_GUID[3]);
+	if (output == NULL && store_output == NULL)
+		make_directory(tmp);
+
+	tmp_length += sprintf(tmp + tmp_length, "%cUDKGame", separator);
+	if (output == NULL && store_output == NULL)
+		make_directory(tmp);
+
+	// Copy config file
+	sprintf(tmp + tmp_length, "%cConfig", separator);
+	if (output == NULL && store_output == NULL)
+		make_directory(tmp);
+	snprintf(tmp + tmp_length + 7, sizeof(tmp) - tmp_length - 7, "%c%s.ini", separator, get_name(package_name));
+	snprintf(tmp2, sizeof(tmp2), "%s%cConfig%c%s.ini", game_path, PATH_SEPARATOR, PATH_SEPARATOR, get_name(package_name));
+	add_package_file(output, store_output, tmp2, tmp);
+
+	tmp_length += sprintf(tmp + tmp_length, "%cCookedPC", separator);
+	if (output == NULL && store_output == NULL)
+		make_directory(tmp);
+
+	tmp_length += sprintf(tmp + tmp_length, "%cCustom_Content", separator);
+	if (output == NULL && store_output == NULL && make_directory(tmp) == false)
+	{
+		printf("ERROR: Unable to create %s\n", tmp);
+		mutex_destroy(&copy_lock);
+		return false;
+	}
+
+	// Copy base package
+	snprintf(tmp + tmp_length, sizeof(tmp) - tmp_length, "%c%s.%s", separator, get_name(package_name), extension_as_string(package_extension));
+	add_package_file(output, store_output, package_filename, tmp);
+
+	for (index = 0; index != dependency_list_size; ++index) // Copy dependencies
+	{
+		snprintf(tmp + tmp_length, sizeof(tmp) - tmp_length, "%c%s.%s", separator, get_package_name(dependency_list[index]), extension_as_string(dependency_list[index]->extension));
+		if (dependency_list[index]->filename != NULL)
+			add_package_file(output, store_output, dependency_list[index]->filename, tmp);
+		else
+		{
+			printf("ERROR: Unable to find package %s\n", get_package_name(dependency_list[index]));
+			++failures;
+		}
+	}
+
+	if (output != NULL && close_archive(output) == false)
+	{
+		puts("ERROR: Unable to write archive.");
+		++failures;
+	}
+
+	work_pool_wait(get_work_pool());
+	mutex_destroy(&copy_lock);
+
+	if (store_output != NULL)
+	{
+		sprintf(tmp, "%.8X%.8X%.8X%.8X.manifest", package_GUID[0], package_GUID[1], package_GUID[2], package_GUID[3]);
+		failures += close_store(store_output, tmp);
+	}
+
+	return failures + copy_failures == 0;
+}
+
+/** Package Functions */
+
+/** Loads the base package; returns an error message, or NULL on success */
+const char *load_package(const char *filename)
+{
+	struct UDKPackage_File base_package;
+
+	if (open_package_file(&base_package, filename) == false)
+		return "ERROR: UNABLE TO OPEN FILE.";
+
+	package_filename = filename;
+	package_extension = get_extension_from_filename(filename, strlen(filename));
+
+	memcpy(package_GUID, base_package.summary.GUID, sizeof(package_GUID));
+	if (read_name_table(&base_package) == false || read_import_table(&base_package) == false)
+	{
+		close_package_file(&base_package);
+		return "ERROR: MALFORMED PACKAGE.";
+	}
+
+	package_name = name_from_filename(filename, strlen(filename));
+
+	close_package_file(&base_package);
+	return NULL;
+}
+
+/** Releases everything read or built for the base package */
+void free_package()
+{
+	size_t index;
+
+	free(dependency_list);
+	dependency_list = NULL;
+	dependency_list_size = 0;
+	dependency_list_capacity = 0;
+	free_transitive_package_table();
+	free_package_usage();
+
+	if (package_table != NULL)
+	{
+		for (index = 0; index != packages_imported; ++index)
+			free(package_table[index].filename);
+		free(package_table);
+		package_table = NULL;
+	}
+
+	free(import_table);
+	import_table = NULL;
+	import_table_size = 0;
+	packages_imported = 0;
+
+	free_name_table();
+	package_filename = NULL;
+}
+
+/** Benchmark Functions */
+
+/**
+ * -benchmark DIR generates a synthetic map and game tree under DIR, runs the packaging pipeline over it one phase at a
+ * time and prints the timings as JSON. Sizes come from -benchmark-names, -benchmark-imports and -benchmark-files.
+ */
+
+#define BENCHMARK_MAP_NAME "BenchMap"
+#define BENCHMARK_FILES_PER_DIRECTORY 100
+#define BENCHMARK_LOOKUPS 200000
+
+uint32_t benchmark_names = 10000;
+uint32_t benchmark_imports = 1000;
+uint32_t benchmark_files = 5000;
+
+struct Byte_Buffer
+{
+	uint8_t *data;
+	size_t size;
+	size_t capacity;
+};
+
+void append_bytes(struct Byte_Buffer *buffer, const void *data, size_t size)
+{
+	if (buffer->size + size > buffer->capacity)
+	{
+		while (buffer->size + size > buffer->capacity)
+			buffer->capacity = buffer->capacity == 0 ? 4096 : buffer->capacity * 2;
+		buffer->data = (uint8_t *) realloc(buffer->data, buffer->capacity);
+	}
+
+	memcpy(buffer->data + buffer->size, data, size);
+	buffer->size += size;
+}
+
+void append_uint32(struct Byte_Buffer *buffer, uint32_t value)
+{
+	append_bytes(buffer, &value, sizeof(value));
+}
+
+void patch_uint32(struct Byte_Buffer *buffer, size_t offset, uint32_t value)
+{
+	memcpy(buffer->data + offset, &value, sizeof(value));
+}
+
+void append_fstring(struct Byte_Buffer *buffer, const char *string)
+{
+	uint32_t length = (uint32_t) strlen(string) + 1;
+
+	append_uint32(buffer, length);
+	append_bytes(buffer, string, length);
+}
+
+bool write_bytes(const char *filename, const uint8_t *data, size_t size)
+{
+	FILE *file = fopen(filename, "wb");
+	bool result = file != NULL && fwrite(data, sizeof(uint8_t), size, file) == size;
+
+	if (file != NULL)
+		result = fclose(file) == 0 && result;
+
+	return result;
+}
+
+/** Builds a minimal uncompressed UE3 package in buffer: summary, room for chunk_count chunks, name table and an import table of package imports; the GUID is derived from filename */
+void build_synthetic_package(struct Byte_Buffer *buffer, const char *filename, const char *const *names, uint32_t name_count, const uint32_t *imported_names, uint32_t import_count, uint32_t chunk_count)
+{
+	size_t summary;
+	uint64_t hash;
+	uint32_t index;
+
+	append_uint32(buffer, UDK_PACKAGE_TAG);
+	append_uint32(buffer, 868); // file version 868, licensee version 0
+	append_uint32(buffer, 0); // header size
+	append_fstring(buffer, "None");
+
+	// flags, name count/offset, export count/offset, import count/offset, depends offset, four unused
+	summary = buffer->size;
+	for (index = 0; index != 12; ++index)
+		append_uint32(buffer, 0);
+
+	hash = xxh64((const uint8_t *) filename, strlen(filename), 0);
+	append_bytes(buffer, &hash, sizeof(hash));
+	hash = xxh64((const uint8_t *) filename, strlen(filename), 1);
+	append_bytes(buffer, &hash, sizeof(hash));
+
+	// no generations, engine and cooker version, uncompressed, then a zeroed chunk table for write_compressed_package
+	append_uint32(buffer, 0);
+	append_uint32(buffer, 10);
+	append_uint32(buffer, 0);
+	append_uint32(buffer, 0);
+	append_uint32(buffer, chunk_count);
+	for (index = 0; index != chunk_count * 4; ++index)
+		append_uint32(buffer, 0);
+
+	patch_uint32(buffer, summary + 0x04, name_count);
+	patch_uint32(buffer, summary + 0x08, (uint32_t) buffer->size);
+	for (index = 0; index != name_count; ++index)
+	{
+		append_fstring(buffer, names[index]);
+		append_uint32(buffer, 0);
+		append_uint32(buffer, 0);
+	}
+
+	// Core.Package'<name>' for every import
+	patch_uint32(buffer, summary + 0x14, import_count);
+	patch_uint32(buffer, summary + 0x18, (uint32_t) buffer->size);
+	for (index = 0; index != import_count; ++index)
+	{
+		append_uint32(buffer, 1);
+		append_uint32(buffer, 0);
+		append_uint32(buffer, 2);
+		append_uint32(buffer, 0);
+		append_uint32(buffer, 0);
+		append_uint32(buffer, imported_names[index]);
+		append_uint32(buffer, 0);
+	}
+
+	patch_uint32(buffer, 0x08, (uint32_t) buffer->size);
+}
+
+/** Writes a minimal uncompressed UE3 package; see build_synthetic_package */
+bool write_synthetic_package(const char *filename, const char *const *names, uint32_t name_count, const uint32_t *imported_names, uint32_t import_count)
+{
+	struct Byte_Buffer buffer = { NULL, 0, 0 };
+	bool result;
+
+	build_synthetic_package(&buffer, filename, names, name_count, imported_names, import_count, 0);
+	result = write_bytes(filename, buffer.data, buffer.size);
+	free(buffer.data);
+	return result;
+}
+
+#if defined HAVE_ZLIB
+/**
+ * Writes package (built with room for chunk_count chunks) zlib-compressed: everything from the name table on is split
+ * into chunk_count chunks of one block each, and the chunk table is patched into package as well. trailing_size bytes
+ * follow the last chunk, as unrelated data does in some cooked packages.
+ */
+bool write_compressed_package(const char *filename, struct Byte_Buffer *package, uint32_t chunk_count, size_t trailing_size)
+{
+	struct UDKPackage_Summary summary;
+	struct Byte_Buffer file = { NULL, 0, 0 };
+	size_t chunk_table;
+	uint8_t *block = NULL;
+	uLongf block_size;
+	size_t data_start;
+	size_t chunk_start;
+	size_t chunk_size;
+	uint32_t index;
+	bool result;
+
+	if (decode_package_summary(&summary, package->data, package->size) == false
+		|| decode_package_chunks(&summary, package->data, package->size) == false
+		|| summary.chunk_count != chunk_count || chunk_count == 0)
+		return false;
+
+	chunk_table = (size_t) (summary.chunk_table - package->data);
+	patch_uint32(package, chunk_table - 8, UDK_COMPRESS_ZLIB);
+	data_start = summary.name_offset;
+	append_bytes(&file, package->data, data_start);
+
+	for (index = 0; index != chunk_count; ++index)
+	{
+		chunk_start = data_start + (package->size - data_start) * index / chunk_count;
+		chunk_size = data_start + (package->size - data_start) * (index + 1) / chunk_count - chunk_start;
+		block_size = compressBound((uLong) chunk_size);
+		block = (uint8_t *) realloc(block, block_size);
+		if (compress(block, &block_size, package->data + chunk_start, (uLong) chunk_size) != Z_OK)
+		{
+			free(block);
+			free(file.data);
+			return false;
+		}
+
+		// uncompressed offset and size, compressed offset and size
+		patch_uint32(package, chunk_table + (size_t) index * UDK_CHUNK_INFO_SIZE, (uint32_t) chunk_start);
+		patch_uint32(package, chunk_table + (size_t) index * UDK_CHUNK_INFO_SIZE + 4, (uint32_t) chunk_size);
+		patch_uint32(package, chunk_table + (size_t) index * UDK_CHUNK_INFO_SIZE + 8, (uint32_t) file.size);
+		patch_uint32(package, chunk_table + (size_t) index * UDK_CHUNK_INFO_SIZE + 12, (uint32_t) (24 + block_size));
+
+		// tag, block size, compressed and uncompressed totals, then the one block's sizes and data
+		append_uint32(&file, UDK_PACKAGE_TAG);
+		append_uint32(&file, 0x20000);
+		append_uint32(&file, (uint32_t) block_size);
+		append_uint32(&file, (uint32_t) chunk_size);
+		append_uint32(&file, (uint32_t) block_size);
+		append_uint32(&file, (uint32_t) chunk_size);
+		append_bytes(&file, block, block_size);
+	}
+
+	// the summary, now with its chunk table, goes out as-is
+	memcpy(file.data, package->data, data_start);
+	for (index = 0; index != trailing_size; ++index)
+		append_bytes(&file, "\xA5", 1);
+
+	result = write_bytes(filename, file.data, file.size);
+	free(block);
+	free(file.data);
+	return result;
+}
+#endif // HAVE_ZLIB
+
+/** Builds "None", "Core", "Package", the map name, the imported package names and then filler up to name_count */
+char **make_synthetic_names(uint32_t name_count, uint32_t import_count)
+{
+	char **names = (char **) malloc(sizeof(char *) * name_count);
+	char tmp[32];
+	uint32_t index;
+
+	for (index = 0; index != name_count; ++index)
+	{
+		if (index == 0)
+			strcpy(tmp, "None");
+		else if (index == 1)
+			strcpy(tmp, "Core");
+		else if (index == 2)
+			strcpy(tmp, "Package");
+		else if (index == 3)
+			strcpy(tmp, BENCHMARK_MAP_NAME);
+		else if (index - 4 < import_count)
+			sprintf(tmp, "Pkg%.6u", index - 4);
+		else
+			sprintf(tmp, "Name%.6u", index);
+		names[index] = strdup(tmp);
+	}
+
+	return names;
+}
+
+void free_synthetic_names(char **names, uint32_t name_count)
+{
+	uint32_t index;
+
+	for (index = 0; index != name_count; ++index)
+		free(names[index]);
+	free(names);
+}
+
+/**
+ * Writes BENCHMARK_MAP_NAME.udk, game/Config and one package per file under game/CookedPC/DirNNNN, where the first
+ * import_count game packages are the map's imports. Pkg000000 also gets a copy under game/CookedPC/Copies, which must
+ * win as the lower path.
+ */
+bool generate_benchmark_tree(uint32_t name_count, uint32_t import_count, uint32_t file_count)
+{
+	char **names = make_synthetic_names(name_count, import_count);
+	uint32_t *imported_names = (uint32_t *) malloc(sizeof(uint32_t) * (import_count + 1));
+	const char *package_names[4] = { "None", "Core", "Package", NULL };
+	char name[32];
+	char path[256];
+	FILE *file;
+	uint32_t index;
+	bool result;
+
+	for (index = 0; index != import_count; ++index)
+		imported_names[index] = 4 + index;
+
+	result = write_synthetic_package(BENCHMARK_MAP_NAME ".udk", (const char *const *) names, name_count, imported_names, import_count);
+
+	make_directory("game");
+	sprintf(path, "game%cConfig", PATH_SEPARATOR);
+	make_directory(path);
+	sprintf(path, "game%cCookedPC", PATH_SEPARATOR);
+	make_directory(path);
+
+	sprintf(path, "game%cConfig%c%s.ini", PATH_SEPARATOR, PATH_SEPARATOR, BENCHMARK_MAP_NAME);
+	file = fopen(path, "wb");
+	if (file != NULL)
+		fclose(file);
+	else
+		result = false;
+
+	// Each package names itself and imports Core, like a real content package
+	imported_names[0] = 1;
+	package_names[3] = name;
+
+	for (index = 0; index != file_count && result; ++index)
+	{
+		if (index % BENCHMARK_FILES_PER_DIRECTORY == 0)
+		{
+			sprintf(path, "game%cCookedPC%cDir%.4u", PATH_SEPARATOR, PATH_SEPARATOR, index / BENCHMARK_FILES_PER_DIRECTORY);
+			make_directory(path);
+		}
+
+		sprintf(name, index < import_count ? "Pkg%.6u" : "Filler%.6u", index);
+		sprintf(path, "game%cCookedPC%cDir%.4u%c%s.upk", PATH_SEPARATOR, PATH_SEPARATOR, index / BENCHMARK_FILES_PER_DIRECTORY, PATH_SEPARATOR, name);
+		result = write_synthetic_package(path, package_names, 4, imported_names, 1);
+	}
+
+	if (import_count != 0 && result)
+	{
+		sprintf(path, "game%cCookedPC%cCopies", PATH_SEPARATOR, PATH_SEPARATOR);
+		make_directory(path);
+		strcpy(name, "Pkg000000");
+		sprintf(path, "game%cCookedPC%cCopies%c%s.upk", PATH_SEPARATOR, PATH_SEPARATOR, PATH_SEPARATOR, name);
+		result = write_synthetic_package(path, package_names, 4, imported_names, 1);
+	}
+
+	free(imported_names);
+	free_synthetic_names(names, name_count);
+	return result;
+}
+
+/** Times BENCHMARK_LOOKUPS case-insensitive lookups (half hits, half misses) in a name table of name_count names; returns ns per lookup */
+double benchmark_name_lookup(uint32_t name_count)
+{
+	char **names = make_synthetic_names(name_count, 0);
+	struct UDKPackage_File file;
+	char tmp[32];
+	size_t length;
+	uint32_t index;
+	uint32_t found = 0;
+	uint64_t start;
+	double result = -1.0;
+
+	if (write_synthetic_package("lookup.upk", (const char *const *) names, name_count, NULL, 0) && open_package_file(&file, "lookup.upk"))
+	{
+		if (read_name_table(&file))
+		{
+			start = get_time_ns();
+			for (index = 0; index != BENCHMARK_LOOKUPS; ++index)
+			{
+				if (index % 2 == 0)
+					length = sprintf(tmp, "NAME%.6u", 4 + (uint32_t) (((uint64_t) index * 2654435761U) % (name_count - 4)));
+				else
+					length = sprintf(tmp, "Missing%.6u", index);
+
+				if (find_name_2ptr(tmp, tmp + length) != INVALID_NAME)
+					++found;
+			}
+			result = (double) (get_time_ns() - start) / BENCHMARK_LOOKUPS;
+
+			if (found != BENCHMARK_LOOKUPS / 2)
+				printf("ERROR: %u of %u name lookups succeeded\n", found, BENCHMARK_LOOKUPS / 2);
+		}
+
+		free_name_table();
+		close_package_file(&file);
+	}
+
+	remove("lookup.upk");
+	free_synthetic_names(names, name_count);
+	return result;
+}
+
+/**
+ * Writes a zlib-compressed package with several chunks, one past the tables, and data after the last chunk, then
+ * checks the tables open as written and the whole package decompresses to the original bytes
+ */
+bool check_compressed_package(void)
+{
+#if defined HAVE_ZLIB
+	char **names = make_synthetic_names(2000, 0);
+	uint32_t imported_names[1] = { 4 };
+	struct Byte_Buffer package = { NULL, 0, 0 };
+	struct UDKPackage_File file;
+	uint8_t filler;
+	size_t index;
+	bool result;
+
+	build_synthetic_package(&package, "compressed.upk", (const char *const *) names, 2000, imported_names, 1, 4);
+
+	// export data nothing reads while the tables load
+	for (index = 0; index != 0x10000; ++index)
+	{
+		filler = (uint8_t) (index * 7 + index / 251);
+		append_bytes(&package, &filler, 1);
+	}
+
+	result = write_compressed_package("compressed.upk", &package, 4, 0x20000) && open_package_file(&file, "compressed.upk");
+	if (result)
+	{
+		result = file.size == package.size
+			&& memcmp(file.data, package.data, file.summary.import_offset + UDK_IMPORT_SIZE) == 0
+			&& read_package_range(&file, 0, file.summary.uncompressed_size)
+			&& memcmp(file.data, package.data, package.size) == 0;
+		close_package_file(&file);
+	}
+
+	if (result == false)
+		puts("ERROR: Compressed package did not decompress to what was written.");
+
+	remove("compressed.upk");
+	free(package.data);
+	free_synthetic_names(names, 2000);
+	return result;
+#else
+	return true;
+#endif // HAVE_ZLIB
+}
+
+/** Runs the benchmark in directory and prints JSON results to out; returns false if the pipeline failed */
+bool run_benchmark(const char *directory, FILE *out)
+{
+	static const uint32_t lookup_sizes[] = { 1000, 10000, 50000, 100000, 200000 };
+	struct UDKPackage_File base_package;
+	uint64_t start;
+	double generate_tree_ms;
+	double read_name_table_ms;
+	double read_import_table_ms;
+	double init_package_table_ms;
+	double crawl_ms;
+	double build_dependency_list_ms;
+	double generate_package_ms;
+	char duplicate_path[64];
+	size_t index;
+	bool result;
+
+	if (benchmark_names < 4 + benchmark_imports || benchmark_files < benchmark_imports)
+	{
+		puts("ERROR: -benchmark-names must be at least -benchmark-imports + 4, and -benchmark-files must be at least -benchmark-imports.");
+		return false;
+	}
+
+	make_directory(directory);
+#if defined _WIN32
+	result = SetCurrentDirectory(directory) != FALSE;
+#else
+	result = chdir(directory) == 0;
+#endif // _WIN32
+	if (result == false)
+	{
+		printf("ERROR: Unable to enter %s\n", directory);
+		return false;
+	}
+
+	start = get_time_ns();
+	if (generate_benchmark_tree(benchmark_names, benchmark_imports, benchmark_files) == false)
+	{
+		puts("ERROR: Unable to generate benchmark tree.");
+		return false;
+	}
+	generate_tree_ms = elapsed_ms(start);
+
+	// load_package, split so each table is timed on its own
+	if (open_package_file(&base_package, BENCHMARK_MAP_NAME ".udk") == false)
+	{
+		puts("ERROR: UNABLE TO OPEN FILE.");
+		return false;
+	}
+
+	package_filename = BENCHMARK_MAP_NAME ".udk";
+	package_extension = ext_UDK;
+	memcpy(package_GUID, base_package.summary.GUID, sizeof(package_GUID));
+
+	start = get_time_ns();
+	result = read_name_table(&base_package);
+	read_name_table_ms = elapsed_ms(start);
+
+	start = get_time_ns();
+	result = result && read_import_table(&base_package);
+	read_import_table_ms = elapsed_ms(start);
+
+	close_package_file(&base_package);
+	if (result == false)
+	{
+		puts("ERROR: MALFORMED PACKAGE.");
+		return false;
+	}
+	package_name = name_from_filename(package_filename, strlen(package_filename));
+
+	start = get_time_ns();
+	init_package_table();
+	init_package_table_ms = elapsed_ms(start);
+
+	start = get_time_ns();
+	result = build_package_table("game");
+	crawl_ms = elapsed_ms(start);
+
+	// The duplicate copy must win however the crawl was scheduled
+	sprintf(duplicate_path, "game%cCookedPC%cCopies%cPkg000000.upk", PATH_SEPARATOR, PATH_SEPARATOR, PATH_SEPARATOR);
 	for (index = 0; index != packages_imported; ++index)
-		if (is_in_against_list(package_table[index].GUID) == false)
+		if (strcmpi(get_name(package_table[index].name_index), "Pkg000000") == 0
+			&& (package_table[index].filename == NULL || strcmp(package_table[index].filename, duplicate_path) != 0))
 		{
-			dependency = (struct UDKPackage_Dependency *) malloc(sizeof(struct UDKPackage_Dependency));
-			dependency->next = NULL;
-			dependency->package = &package_table[index];
+			printf("ERROR: Expected Pkg000000 from %s, found %s\n", duplicate_path, package_table[index].filename != NULL ? package_table[index].filename : "nothing");
+			result = false;
+		}
+
+	start = get_time_ns();
+	build_dependency_list();
+	build_dependency_list_ms = elapsed_ms(start);
+
+	start = get_time_ns();
+	result = generate_package("game") && result;
+	generate_package_ms = elapsed_ms(start);
+
+	if (dependency_list_size != benchmark_imports)
+	{
+		printf("ERROR: Expected %u dependencies, found %u\n", benchmark_imports, dependency_list_size);
+		result = false;
+	}
+
+	free_package();
+
+	result = check_compressed_package() && result;
+
+	fprintf(out, "{\n");
+	fprintf(out, "\t\"names\": %u,\n\t\"imports\": %u,\n\t\"files\": %u,\n\t\"threads\": %u,\n", benchmark_names, benchmark_imports, benchmark_files, (unsigned int) get_work_pool()->thread_count);
+	fprintf(out, "\t\"phases_ms\": {\n");
+	fprintf(out, "\t\t\"generate_tree\": %.3f,\n", generate_tree_ms);
+	fprintf(out, "\t\t\"read_name_table\": %.3f,\n", read_name_table_ms);
+	fprintf(out, "\t\t\"read_import_table\": %.3f,\n", read_import_table_ms);
+	fprintf(out, "\t\t\"init_package_table\": %.3f,\n", init_package_table_ms);
+	fprintf(out, "\t\t\"crawl\": %.3f,\n", crawl_ms);
+	fprintf(out, "\t\t\"build_dependency_list\": %.3f,\n", build_dependency_list_ms);
+	fprintf(out, "\t\t\"generate_package\": %.3f\n", generate_package_ms);
+	fprintf(out, "\t},\n");
+
+	fprintf(out, "\t\"name_lookup_ns\": {");
+	for (index = 0; index != sizeof(lookup_sizes) / sizeof(lookup_sizes[0]); ++index)
+		fprintf(out, "%s\n\t\t\"%u\": %.1f", index == 0 ? "" : ",", lookup_sizes[index], benchmark_name_lookup(lookup_sizes[index]));
+	fprintf(out, "\n\t},\n");
+
+	fprintf(out, "\t\"success\": %s\n}\n", result ? "true" : "false");
+	return result;
+}
+
+/** Batch Functions */
+
+struct Batch
+{
+	char **filenames;
+	size_t size;
+	size_t capacity;
+};
+
+void add_batch_file(struct Batch *batch, const char *filename, size_t filename_length)
+{
+	if (batch->size == batch->capacity)
+	{
+		batch->capacity = batch->capacity == 0 ? 64 : batch->capacity * 2;
+		batch->filenames = (char **) realloc(batch->filenames, sizeof(char *) * batch->capacity);
+	}
 
-			if (dependency_list_last != NULL)
-				dependency_list_last->next = dependency;
-			else
-				dependency_list_head = dependency;
+	batch->filenames[batch->size] = (char *) malloc(sizeof(char) * (filename_length + 1));
+	memcpy(batch->filenames[batch->size], filename, filename_length);
+	batch->filenames[batch->size][filename_length] = '\0';
+	++batch->size;
+}
+
+bool is_glob_pattern(const char *str)
+{
+	return strpbrk(str, "*?[") != NULL;
+}
+
+/** Adds every file matching pattern; on Windows only the last path component may contain wildcards */
+bool glob_batch(struct Batch *batch, const char *pattern)
+{
+#if defined _WIN32
+	WIN32_FIND_DATA file_data;
+	HANDLE find_handle;
+	const char *directory_end = pattern + strlen(pattern);
+	size_t directory_length;
+	size_t filename_length;
+	char *tmp;
+
+	while (directory_end != pattern && directory_end[-1] != '\\' && directory_end[-1] != '/')
+		--directory_end;
+	directory_length = directory_end - pattern;
+
+	find_handle = FindFirstFile(pattern, &file_data);
+	if (find_handle == INVALID_HANDLE_VALUE)
+		return false;
 
-			dependency_list_last = dependency;
-			++dependency_list_size;
+	do
+	{
+		if ((file_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+		{
+			filename_length = strlen(file_data.cFileName);
+			tmp = (char *) malloc(sizeof(char) * (directory_length + filename_length + 1));
+			memcpy(tmp, pattern, directory_length);
+			memcpy(tmp + directory_length, file_data.cFileName, filename_length + 1);
+			add_batch_file(batch, tmp, directory_length + filename_length);
+			free(tmp);
 		}
+	} while (FindNextFile(find_handle, &file_data));
+
+	FindClose(find_handle);
+	return true;
+#else
+	glob_t result;
+	size_t index;
+
+	if (glob(pattern, 0, NULL, &result) != 0)
+		return false;
+
+	for (index = 0; index != result.gl_pathc; ++index)
+		add_batch_file(batch, result.gl_pathv[index], strlen(result.gl_pathv[index]));
+
+	globfree(&result);
+	return true;
+#endif // _WIN32
 }
 
-void write_dependency_list(FILE *out)
+/** Reads one filename per line; blank lines and lines starting with '#' are skipped */
+bool read_batch_list(struct Batch *batch, const char *list_filename)
 {
-	struct UDKPackage_Dependency *itr;
+	FILE *list_file = fopen(list_filename, "rb");
+	char line[4096];
+	size_t length;
 
-	fwrite(&dependency_list_size, sizeof(uint32_t), 1, out);
-	for (itr = dependency_list_head; itr != NULL; itr = itr->next)
-		fwrite(itr->package->GUID, sizeof(uint32_t), 4, out);
+	if (list_file == NULL)
+		return false;
+
+	while (fgets(line, sizeof(line), list_file) != NULL)
+	{
+		length = strlen(line);
+		while (length != 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+			--length;
+
+		if (length != 0 && line[0] != '#')
+			add_batch_file(batch, line, length);
+	}
+
+	fclose(list_file);
+	return true;
 }
 
-void print_dependency_list(FILE *out)
+/** Resolves (and optionally packages) one map against the game package index */
+bool process_batch_package(const char *filename, const char *game_path, bool build_package)
 {
-	struct UDKPackage_Dependency *itr = dependency_list_head;
+	const char *error;
+
+	free_package();
+	error = load_package(filename);
+	if (error != NULL)
+	{
+		printf("%s: %s\n", filename, error);
+		fflush(stdout);
+		return false;
+	}
 
-	fprintf(out, "%u dependencies:\n", dependency_list_size);
-	while (itr != NULL)
+	init_package_table();
+	resolve_package_table();
+	if (prune_dependencies)
 	{
-		fprintf(out, "%.8X%.8X%.8X%.8X | ", itr->package->GUID[0], itr->package->GUID[1], itr->package->GUID[2], itr->package->GUID[3]);
-		fputs(name_table[itr->package->name_index], out);
-		fputs(" | ", out);
-		fputs(itr->package->filename, out);
-		fputc('\n', out);
+		analyze_package_usage();
+		warn_unused_packages();
+	}
+	if (transitive_dependencies)
+		build_dependency_graph();
+	else
+		build_dependency_list();
 
-		itr = itr->next;
+	if (build_package && generate_package(game_path) == false)
+	{
+		printf("%s: ERROR: Unable to generate package.\n", filename);
+		fflush(stdout);
+		return false;
 	}
+
+	printf("%s: %u dependencies\n", filename, dependency_list_size);
+	fflush(stdout);
+	return true;
 }
 
-/** Game Package Table Functions */
+/** Processes every map in the batch; returns the number of maps that failed */
+size_t run_batch(struct Batch *batch, const char *game_path, bool build_package)
+{
+	size_t failures = 0;
+	size_t index;
+#if !defined _WIN32
+	size_t thread_budget = thread_count == 0 ? get_processor_count() : thread_count;
+	size_t worker_count = thread_budget;
+	size_t *next; // shared between worker processes
+	pid_t *workers;
+	int status;
+#endif // _WIN32
 
 #if defined _WIN32
+	for (index = 0; index != batch->size; ++index)
+		if (process_batch_package(batch->filenames[index], game_path, build_package) == false)
+			++failures;
+#else
+	// Per-map state is global, so maps run in forked workers that share the game package index copy-on-write
+	if (worker_count > batch->size)
+		worker_count = batch->size;
+
+	next = (size_t *) mmap(NULL, sizeof(size_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (next == MAP_FAILED || worker_count <= 1)
+	{
+		for (index = 0; index != batch->size; ++index)
+			if (process_batch_package(batch->filenames[index], game_path, build_package) == false)
+				++failures;
 
-struct UDKPackage_Game *add_UDKPackage_Game(const char *name, const char *name_end)
-{
-	struct UDKPackage_Game *ret;
+		if (next != MAP_FAILED)
+			munmap(next, sizeof(size_t));
+		return failures;
+	}
 
-	ret = (struct UDKPackage_Game *) malloc(sizeof(struct UDKPackage_Game));
-	ret->next = NULL;
-	ret->name = (char *) malloc(sizeof(char) * (name_end - name + 1));
-	
-	ret->name += name_end - name;
-	*ret->name = '\0';
-	while (name_end != name)
-		*--ret->name = *--name_end;
+	*next = 0;
+	fflush(stdout);
+	workers = (pid_t *) malloc(sizeof(pid_t) * worker_count);
+	for (index = 0; index != worker_count; ++index)
+	{
+		workers[index] = fork();
+		if (workers[index] == 0)
+		{
+			// The parent's worker threads don't exist in the child; the workers split the thread budget between them
+			work_pool = NULL;
+			thread_count = thread_budget / worker_count != 0 ? thread_budget / worker_count : 1;
 
-	if (game_package_table_last != NULL)
-		game_package_table_last->next = ret;
-	else
-		game_package_table_head = ret;
+			while ((index = __atomic_fetch_add(next, 1, __ATOMIC_RELAXED)) < batch->size)
+				if (process_batch_package(batch->filenames[index], game_path, build_package) == false)
+					++failures;
+
+			_exit(failures > 255 ? 255 : (int) failures);
+		}
+	}
+
+	for (index = 0; index != worker_count; ++index)
+	{
+		if (workers[index] < 0)
+			continue;
+
+		if (waitpid(workers[index], &status, 0) < 0 || WIFEXITED(status) == false)
+			++failures;
+		else
+			failures += WEXITSTATUS(status);
+	}
+
+	// Pick up anything left by workers that failed to start
+	while ((index = __atomic_fetch_add(next, 1, __ATOMIC_RELAXED)) < batch->size)
+		if (process_batch_package(batch->filenames[index], game_path, build_package) == false)
+			++failures;
 
-	game_package_table_last = ret;
-	++game_package_table_size;
+	free(workers);
+	munmap(next, sizeof(size_t));
+#endif // _WIN32
 
-	return ret;
+	return failures;
 }
 
-bool build_game_package_table(const char *directory)
+/** Daemon */
+
+/**
+ * -daemon keeps the against list, package cache and game package index in memory and serves maps over a Unix domain
+ * socket, so each map only costs its own parsing. A client sends one line per connection:
+ *
+ *   resolve <map>    replies with the dependency list, as -dependencies writes it
+ *   package <map>    generates the package as -package does, then replies with the dependency list
+ *   shutdown         stops the daemon
+ *
+ * The reply ends with a line that is either "OK" or starts with "ERROR:". Per-map state is global, so requests are
+ * served one at a time; between requests the game package watcher keeps the index current.
+ */
+
+#define DAEMON_REQUEST_SIZE 4096
+
+#if defined __linux__
+
+int open_daemon_socket(const char *path)
 {
-	WIN32_FIND_DATA file_data;
-	HANDLE find_handle;
-	size_t directory_length = 0;
-	char *tmp;
-	size_t tmp_length;
-	FILE *tmp_file;
-	struct UDKPackage_Game *package;
+	struct sockaddr_un address;
+	int result;
+
+	if (strlen(path) >= sizeof(address.sun_path))
+	{
+		puts("ERROR: Socket path is too long.");
+		return -1;
+	}
 
-	find_handle = FindFirstFile(directory, &file_data);
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
 
-	if (find_handle == INVALID_HANDLE_VALUE)
-		return false; // Error: Bad handle
+	result = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (result < 0)
+		return -1;
 
-	do
+	// A socket left behind by a daemon that didn't shut down cleanly
+	unlink(path);
+	if (bind(result, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(result, 16) != 0)
 	{
-		if (file_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-		{
-			if (file_data.cFileName[0] != '.')
-			{
-				// Calculate string lengths
-				if (directory_length == 0)
-					directory_length = strlen(directory) - 1;
-				tmp_length = strlen(file_data.cFileName);
+		printf("ERROR: Unable to listen on %s\n", path);
+		close(result);
+		return -1;
+	}
 
-				tmp = (char *)malloc(sizeof(char) * (directory_length + tmp_length + 3));
+	return result;
+}
 
-				memcpy(tmp, directory, directory_length);
-				memcpy(tmp + directory_length, file_data.cFileName, tmp_length);
+/** Reads one request line into buffer; returns false if the client hung up, timed out or sent too much */
+bool read_daemon_request(int client, char *buffer, size_t size)
+{
+	size_t length = 0;
+	ssize_t count;
+	char *end;
 
-				// Append wildcard and NULL terminator
-				tmp_length += directory_length;
-				tmp[tmp_length] = '\\';
-				tmp[tmp_length + 1] = '*';
-				tmp[tmp_length + 2] = '\0';
+	while (length != size - 1)
+	{
+		count = read(client, buffer + length, size - 1 - length);
+		if (count <= 0)
+			break;
 
-				build_game_package_table(tmp);
-				free(tmp);
-			}
+		length += count;
+		buffer[length] = '\0';
+		end = strchr(buffer, '\n');
+		if (end != NULL)
+		{
+			if (end != buffer && end[-1] == '\r')
+				--end;
+			*end = '\0';
+			return true;
 		}
+	}
+
+	// Allow a final line without a newline
+	buffer[length] = '\0';
+	return length != 0 && length != size - 1;
+}
+
+void handle_daemon_request(int client, const char *game_path)
+{
+	struct timeval timeout = { 5, 0 };
+	char request[DAEMON_REQUEST_SIZE];
+	struct Writer writer;
+	FILE *out;
+	bool build_package;
+	const char *map;
+
+	// A stalled client mustn't hold up everyone behind it
+	setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	out = fdopen(client, "w");
+	if (out == NULL)
+	{
+		close(client);
+		return;
+	}
+
+	if (read_daemon_request(client, request, sizeof(request)) == false)
+		fputs("ERROR: Malformed request.\n", out);
+	else if (strcmp(request, "shutdown") == 0)
+	{
+		stop_requested = 1;
+		fputs("OK\n", out);
+	}
+	else if (strncmp(request, "resolve ", 8) == 0 || strncmp(request, "package ", 8) == 0)
+	{
+		build_package = request[0] == 'p';
+		map = request + 8;
+
+		if (process_batch_package(map, game_path, build_package) == false)
+			fprintf(out, "ERROR: Unable to process %s\n", map);
 		else
 		{
-			tmp = (char *)str_find_suffix(file_data.cFileName, ".upk");
-			if (tmp == NULL)
-			{
-				tmp = (char *)str_find_suffix(file_data.cFileName, ".udk");
-				if (tmp == NULL)
-					tmp = (char *)str_find_suffix(file_data.cFileName, ".u");
-			}
+			// in the -format of the daemon, then the status line
+			open_writer(&writer, out);
+			print_dependency_list(&writer);
+			close_writer(&writer);
+			fputs("OK\n", out);
+		}
+	}
+	else
+		fputs("ERROR: Unknown request.\n", out);
 
-			if (tmp != NULL)
-			{
-				package = add_UDKPackage_Game(file_data.cFileName, tmp);
+	fclose(out);
+}
 
-				// Calculate string lengths
-				if (directory_length == 0)
-					directory_length = strlen(directory) - 1;
-				tmp_length = strlen(file_data.cFileName);
+/** Serves requests on socket_path until a shutdown request or SIGINT/SIGTERM; returns false if it couldn't start */
+bool run_daemon(const char *socket_path, const char *game_path)
+{
+	struct Game_Watcher watcher;
+	struct pollfd fds[2];
+	int listen_fd;
+	int client;
 
-				tmp = (char *)malloc(sizeof(char) * (directory_length + tmp_length + 1));
+	install_stop_handlers();
 
-				memcpy(tmp, directory, directory_length);
-				memcpy(tmp + directory_length, file_data.cFileName, tmp_length);
-				tmp[directory_length + tmp_length] = '\0';
+	// Watch before crawling so nothing that changes during the crawl is missed
+	if (open_game_watcher(&watcher, game_path) == false)
+	{
+		puts("ERROR: Unable to watch the game directory.");
+		return false;
+	}
 
-				tmp_file = fopen(tmp, "rb");
-				if (tmp_file != NULL)
-				{
-					read_guid(package->GUID, tmp_file);
-					fclose(tmp_file);
-				}
+	if (game_package_table_size == 0)
+		build_game_package_table(game_path);
+	build_game_package_index();
+
+	listen_fd = open_daemon_socket(socket_path);
+	if (listen_fd < 0)
+	{
+		close_game_watcher(&watcher);
+		return false;
+	}
 
-				free(tmp);
+	printf("Listening on %s with %u game packages.\n", socket_path, (unsigned int) game_package_table_size);
+	fflush(stdout);
+
+	fds[0].fd = listen_fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = watcher.fd;
+	fds[1].events = POLLIN;
+
+	while (stop_requested == 0)
+	{
+		fds[1].fd = watcher.fd; // replaced after an overflow
+		if (poll(fds, 2, -1) < 0)
+			continue;
+
+		// Apply changes before serving anything, so a request never sees a stale index
+		if (fds[1].revents & POLLIN)
+		{
+			if (process_game_watcher_events(&watcher))
+			{
+				printf("Game package table updated: %u packages.\n", (unsigned int) game_package_table_size);
+				fflush(stdout);
 			}
 		}
-	} while (FindNextFile(find_handle, &file_data));
 
-	FindClose(find_handle);
+		if (fds[0].revents & POLLIN)
+		{
+			client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+			if (client >= 0)
+			{
+				process_game_watcher_events(&watcher);
+				handle_daemon_request(client, game_path);
+			}
+		}
+	}
+
+	close(listen_fd);
+	unlink(socket_path);
+	close_game_watcher(&watcher);
+	free_package();
+
+	puts("Daemon stopped.");
 	return true;
 }
 
-#endif // _WIN32
+#else
 
-void print_game_package_table(FILE *out)
+bool run_daemon(const char *socket_path, const char *game_path)
 {
-	struct UDKPackage_Game *itr = game_package_table_head;
+	(void) socket_path;
+	(void) game_path;
 
-	while (itr != NULL)
+	puts("ERROR: -daemon requires inotify, which is only available on Linux.");
+	return false;
+}
+
+#endif // __linux__
+
+/** Watch Mode */
+
+/** Writes the against list to filename through a temporary file, so readers never see a partial list */
+bool save_against_list(const char *filename, bool legacy)
+{
+	char *tmp_filename = (char *) malloc(sizeof(char) * (strlen(filename) + 32));
+	FILE *against_file;
+	bool result;
+
+	sprintf(tmp_filename, "%s.%lu.tmp", filename, get_process_id());
+	against_file = fopen(tmp_filename, "wb");
+	if (against_file == NULL)
 	{
-		fprintf(out, "%.8X%.8X%.8X%.8X | ", itr->GUID[0], itr->GUID[1], itr->GUID[2], itr->GUID[3]);
-		fputs(itr->name, out);
-		fputc('\n', out);
-		itr = itr->next;
+		free(tmp_filename);
+		return false;
 	}
+
+	if (legacy)
+		write_legacy_against_list(against_file);
+	else
+		write_against_list(against_file);
+
+	result = ferror(against_file) == 0;
+	result = fclose(against_file) == 0 && result;
+	stat_add(stat_syscalls, 1);
+
+#if defined _WIN32
+	result = result && MoveFileEx(tmp_filename, filename, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	result = result && rename(tmp_filename, filename) == 0;
+#endif // _WIN32
+	if (result == false)
+		remove(tmp_filename);
+
+	free(tmp_filename);
+	return result;
 }
 
-/** Packager */
+#if defined __linux__
 
-void generate_package(const char *game_path)
+/** Keeps the game package table live and rewrites the against list at filename whenever it changes, until SIGINT/SIGTERM */
+bool run_watch(const char *game_path, const char *filename, bool legacy)
 {
-	struct UDKPackage_Dependency *itr = dependency_list_head;
-	char tmp[1024]; // 32 (directory) + 1 ('\') + 32 (filename) + 4 (".uxx") + 1 ('\0') = 70
-	char tmp2[1024];
-	size_t tmp_length = 0;
+	struct Game_Watcher watcher;
+	struct pollfd fds;
+	bool changed;
 
-	tmp_length = sprintf(tmp, "%.8X%.8X%.8X%.8X", package_GUID[0], package_GUID[1], package_GUID[2], package_GUID[3]);
-	CreateDirectory(tmp, NULL);
+	install_stop_handlers();
 
-	tmp_length += sprintf(tmp + tmp_length, "\\UDKGame");
-	CreateDirectory(tmp, NULL);
+	// Watch before crawling so nothing that changes during the crawl is missed
+	if (open_game_watcher(&watcher, game_path) == false)
+	{
+		puts("ERROR: Unable to watch the game directory.");
+		return false;
+	}
 
-	// Copy config file
-	sprintf(tmp + tmp_length, "\\Config");
-	CreateDirectory(tmp, NULL);
-	sprintf(tmp + tmp_length + 7, "\\%s.ini", name_table[package_name]);
-	sprintf(tmp2, "%s\\Config\\%s.ini", game_path, name_table[package_name]);
-	CopyFile(tmp2, tmp, false);
+	if (game_package_table_size == 0)
+		build_game_package_table(game_path);
 
-	tmp_length += sprintf(tmp + tmp_length, "\\CookedPC");
-	CreateDirectory(tmp, NULL);
+	build_against_list();
+	if (save_against_list(filename, legacy) == false)
+		printf("ERROR: Unable to write %s\n", filename);
+	printf("Against list written: %u packages. Watching for changes.\n", against_list_size);
+	fflush(stdout);
 
-	tmp_length += sprintf(tmp + tmp_length, "\\Custom_Content");
-	CreateDirectory(tmp, NULL);
+	fds.events = POLLIN;
+	while (stop_requested == 0)
+	{
+		fds.fd = watcher.fd; // replaced after an overflow
+		if (poll(&fds, 1, -1) <= 0)
+			continue;
 
-	// Copy base package
-	sprintf(tmp + tmp_length, "\\%s.%s", name_table[package_name], extension_as_string(package_extension));
-	CopyFile(package_filename, tmp, false);
+		changed = process_game_watcher_events(&watcher);
+		while (stop_requested == 0 && poll(&fds, 1, GAME_WATCHER_SETTLE_MS) > 0)
+		{
+			changed |= process_game_watcher_events(&watcher);
+			fds.fd = watcher.fd;
+		}
 
-	while (itr != NULL) // Copy dependencies
-	{
-		sprintf(tmp + tmp_length, "\\%s.%s", name_table[itr->package->name_index], extension_as_string(itr->package->extension));
-		CopyFile(itr->package->filename, tmp, false);
-		itr = itr->next;
+		if (changed)
+		{
+			build_against_list();
+			if (save_against_list(filename, legacy) == false)
+				printf("ERROR: Unable to write %s\n", filename);
+			printf("Against list updated: %u packages.\n", against_list_size);
+			fflush(stdout);
+		}
 	}
+
+	close_game_watcher(&watcher);
+	puts("Watch stopped.");
+	return true;
+}
+
+#else
+
+bool run_watch(const char *game_path, const char *filename, bool legacy)
+{
+	(void) game_path;
+	(void) filename;
+	(void) legacy;
+
+	puts("ERROR: -watch requires inotify, which is only available on Linux.");
+	return false;
 }
 
+#endif // __linux__
+
 /** Main (Entry Point) */
 
 int main(int argc, const char **args)
@@ -780,35 +7070,74 @@ int main(int argc, const char **args)
 	const char *game_path = "";
 	const char *names_out = NULL;
 	const char *imports_out = NULL;
+	const char *exports_out = NULL;
+	struct UDKPackage_File base_package;
 	const char *dependencies_out = NULL;
+	const char *prune_out = NULL;
 	const char *against_in = NULL;
 	const char *packages_out = NULL;
 	const char *game_packages_out = NULL;
 	const char *against_out = NULL;
-	char *search_path = NULL;
+	const char *batch_in = NULL;
+	const char *daemon_socket = NULL;
+	const char *cache_filename = NULL;
+	const char *benchmark_directory = NULL;
+	const char *trace_out = NULL;
+	bool print_statistics = false;
 	bool build_package = false;
-	FILE *base_package = NULL;
+	bool legacy_against = false;
+	bool watch_game_path = false;
+	const char *error;
+	struct Batch batch = { NULL, 0, 0 };
+	size_t batch_failures = 0;
 	FILE *tmp_file = NULL;
 	size_t index;
 
 	if (argc < 2 || strcmp(args[1], "-help") == 0 || strcmp(args[1], "/?") == 0)
 	{
-		puts("[-in=\"\"] [-game-path=\"*\"] [-package] [-names=\"\"] [-imports=\"\"] [-dependencies=\"\"] [-against=\"\"] [-packages=\"\"] [-game-packages=\"\"] [-build-against=\"\"]");
+		puts("[-in=\"\"] [-batch=\"\"] [-daemon=\"\"] [-game-path=\"*\"] [-prefer=\"\"] [-package] [-transitive] [-hardlink] [-archive] [-compress=\"0\"] [-store=\"\"] [-names=\"\"] [-imports=\"\"] [-exports=\"\"] [-dependencies=\"\"] [-format=\"text\"] [-prune] [-prune-report=\"\"] [-against=\"\"] [-packages=\"\"] [-game-packages=\"\"] [-build-against=\"\"] [-legacy-against] [-watch] [-cache=\"\"] [-no-io-uring] [-threads=\"0\"] [-stats] [-trace=\"\"] [-benchmark=\"\"] [-benchmark-names=\"10000\"] [-benchmark-imports=\"1000\"] [-benchmark-files=\"5000\"]");
 		return 0;
 	}
 
-	for (index = 1; index != argc; ++index)
+	for (index = 1; index != (size_t) argc; ++index)
 	{
 		if (strcmp(args[index], "-in") == 0 || strcmp(args[index], "-level") == 0 || strcmp(args[index], "-map") == 0 || strcmp(args[index], "-file") == 0 || strcmp(args[index], "-filename") == 0)
 			package_filename = args[++index];
+		else if (strcmp(args[index], "-batch") == 0)
+			batch_in = args[++index];
+		else if (strcmp(args[index], "-daemon") == 0)
+			daemon_socket = args[++index];
 		else if (strcmp(args[index], "-game-path") == 0)
 			game_path = args[++index];
+		else if (strcmp(args[index], "-prefer") == 0)
+		{
+			search_roots = (const char **) realloc((void *) search_roots, sizeof(const char *) * (search_roots_size + 1));
+			search_roots[search_roots_size++] = args[++index];
+		}
 		else if (strcmp(args[index], "-names") == 0)
 			names_out = args[++index];
 		else if (strcmp(args[index], "-imports") == 0)
 			imports_out = args[++index];
+		else if (strcmp(args[index], "-exports") == 0)
+			exports_out = args[++index];
 		else if (strcmp(args[index], "-dependencies") == 0)
 			dependencies_out = args[++index];
+		else if (strcmp(args[index], "-format") == 0)
+		{
+			++index;
+			if (strcmp(args[index], "json") == 0)
+				output_format = format_json;
+			else if (strcmp(args[index], "binary") == 0)
+				output_format = format_binary;
+			else if (strcmp(args[index], "text") == 0)
+				output_format = format_text;
+			else
+				printf("ERROR: Unknown output format %s; writing text.\n", args[index]);
+		}
+		else if (strcmp(args[index], "-prune-report") == 0)
+			prune_out = args[++index];
+		else if (strcmp(args[index], "-prune") == 0)
+			prune_dependencies = true;
 		else if (strcmp(args[index], "-against") == 0)
 			against_in = args[++index];
 		else if (strcmp(args[index], "-packages") == 0)
@@ -817,136 +7146,263 @@ int main(int argc, const char **args)
 			game_packages_out = args[++index];
 		else if (strcmp(args[index], "-build-against") == 0)
 			against_out = args[++index];
+		else if (strcmp(args[index], "-cache") == 0)
+			cache_filename = args[++index];
+		else if (strcmp(args[index], "-no-io-uring") == 0)
+			use_io_uring = false;
+		else if (strcmp(args[index], "-threads") == 0)
+			thread_count = strtoul(args[++index], NULL, 10);
+		else if (strcmp(args[index], "-legacy-against") == 0)
+			legacy_against = true;
+		else if (strcmp(args[index], "-watch") == 0)
+			watch_game_path = true;
 		else if (strcmp(args[index], "-package") == 0)
 			build_package = true;
+		else if (strcmp(args[index], "-transitive") == 0)
+			transitive_dependencies = true;
+		else if (strcmp(args[index], "-hardlink") == 0)
+			copy_hardlinks = true;
+		else if (strcmp(args[index], "-archive") == 0)
+			archive_output = true;
+		else if (strcmp(args[index], "-stats") == 0)
+			print_statistics = true;
+		else if (strcmp(args[index], "-trace") == 0)
+			trace_out = args[++index];
+		else if (strcmp(args[index], "-benchmark") == 0)
+			benchmark_directory = args[++index];
+		else if (strcmp(args[index], "-benchmark-names") == 0)
+			benchmark_names = strtoul(args[++index], NULL, 10);
+		else if (strcmp(args[index], "-benchmark-imports") == 0)
+			benchmark_imports = strtoul(args[++index], NULL, 10);
+		else if (strcmp(args[index], "-benchmark-files") == 0)
+			benchmark_files = strtoul(args[++index], NULL, 10);
+		else if (strcmp(args[index], "-store") == 0)
+			store_directory = args[++index];
+		else if (strcmp(args[index], "-compress") == 0)
+			archive_compression = atoi(args[++index]);
 	}
 
-	if (against_in != NULL)
+#if !defined HAVE_ZLIB
+	if (archive_compression != 0)
 	{
-		tmp_file = fopen(against_in, "rb");
-		if (tmp_file != NULL)
-		{
-			read_against_list(tmp_file);
-			fclose(tmp_file);
-		}
+		puts("ERROR: -compress requires a build with HAVE_ZLIB; archives will be stored uncompressed.");
+		archive_compression = 0;
 	}
+#endif // HAVE_ZLIB
 
-	if (game_path != NULL)
+	if (benchmark_directory != NULL)
 	{
-		search_path = (char *) malloc(sizeof(char) * strlen(game_path) + 3);
-		sprintf(search_path, "%s\\*", game_path);
+		batch_failures = run_benchmark(benchmark_directory, stdout) ? 0 : 1;
+		if (work_pool != NULL)
+			work_pool_destroy(work_pool);
+		return (int) batch_failures;
 	}
 
-	if (package_filename != NULL)
+	if (print_statistics || trace_out != NULL)
+		enable_stats();
+
+	begin_phase("load_against_list");
+	if (against_in != NULL && load_against_list(against_in) == false)
+		puts("ERROR: Unable to read against list.");
+	end_phase();
+
+	if (cache_filename != NULL)
+	{
+		begin_phase("load_cache");
+		load_package_cache(cache_filename);
+		end_phase();
+	}
+
+	if (batch_in != NULL)
 	{
-		base_package = fopen(package_filename, "rb");
-		if (base_package == NULL)
+		if ((is_glob_pattern(batch_in) ? glob_batch(&batch, batch_in) : read_batch_list(&batch, batch_in)) == false)
 		{
-			puts("ERROR: UNABLE TO OPEN FILE.");
-			return 0;
+			puts("ERROR: Unable to read batch.");
+			return 1;
 		}
 
-		package_extension = get_extension_from_filename(package_filename, strlen(package_filename));
+		// One crawl serves every map in the batch
+		begin_phase("game_package_table");
+		build_game_package_table(game_path);
+		build_game_package_index();
+		end_phase();
+
+		begin_phase("batch");
+		batch_failures = run_batch(&batch, game_path, build_package);
+		free_package();
+		end_phase();
+	}
 
-		read_guid(package_GUID, base_package);
-		read_name_table(base_package);
-		read_import_table(base_package);
+	if (daemon_socket != NULL)
+	{
+		begin_phase("daemon");
+		if (run_daemon(daemon_socket, game_path) == false)
+			batch_failures = 1;
+		end_phase();
+	}
 
-		package_name = name_from_filename(package_filename, strlen(package_filename));
+	if (watch_game_path)
+	{
+		begin_phase("watch");
+		if (against_out == NULL)
+		{
+			puts("ERROR: -watch requires -build-against.");
+			batch_failures = 1;
+		}
+		else if (run_watch(game_path, against_out, legacy_against) == false)
+			batch_failures = 1;
+		end_phase();
+	}
 
-		fclose(base_package);
+	if (package_filename != NULL)
+	{
+		begin_phase("load_package");
+		error = load_package(package_filename);
+		end_phase();
+		if (error != NULL)
+		{
+			puts(error);
+			return 0;
+		}
 
+		begin_phase("package_table");
 		init_package_table();
-		build_package_table(search_path == NULL ? "*": search_path);
+		if (transitive_dependencies)
+		{
+			// Dependencies of dependencies can be named anything, so index the whole game once
+			build_game_package_table(game_path);
+			build_game_package_index();
+			resolve_package_table();
+		}
+		else
+			build_package_table(game_path);
+		end_phase();
+
+		if (prune_dependencies || prune_out != NULL)
+		{
+			begin_phase("package_usage");
+			analyze_package_usage();
+			if (prune_dependencies)
+				warn_unused_packages();
+			end_phase();
+		}
 
 		if (build_package || dependencies_out != NULL)
-			build_dependency_list();
+		{
+			begin_phase("dependencies");
+			if (transitive_dependencies)
+				build_dependency_graph();
+			else
+				build_dependency_list();
+			end_phase();
+		}
 
 		if (build_package)
-			generate_package(game_path);
+		{
+			begin_phase("generate_package");
+			if (generate_package(game_path) == false)
+			{
+				puts("ERROR: Unable to generate package.");
+				batch_failures = 1;
+			}
+			end_phase();
+		}
 	}
 
-	if (game_packages_out != NULL || against_out != NULL)
-		build_game_package_table(search_path == NULL ? "*" : search_path);
+	if ((game_packages_out != NULL || (against_out != NULL && watch_game_path == false)) && game_package_table_size == 0)
+	{
+		begin_phase("game_package_table");
+		build_game_package_table(game_path);
+		end_phase();
+	}
 
-	if (against_out != NULL)
+	// -watch kept the against list current itself, and rewriting it here would race its readers
+	if (against_out != NULL && watch_game_path == false)
+	{
+		begin_phase("build_against_list");
 		build_against_list();
+		end_phase();
+	}
 
 	/** Write requested data */
 
-	if (names_out != NULL)
-	{
-		tmp_file = fopen(names_out, "wb");
-		if (tmp_file != NULL)
-		{
-			print_name_table(tmp_file);
-			fclose(tmp_file);
-		}
-		else
-			puts("ERROR: Unable to write name table.");
-	}
+	begin_phase("write_outputs");
+
+	if (names_out != NULL && write_table(names_out, print_name_table) == false)
+		puts("ERROR: Unable to write name table.");
 
 	if (imports_out != NULL)
 	{
-		tmp_file = fopen(imports_out, "wb");
-		if (tmp_file != NULL)
-		{
-			print_import_table(tmp_file);
-			fclose(tmp_file);
-
+		if (write_table(imports_out, print_import_table))
 			printf("%u import table entries written.\n", import_table_size);
-		}
 		else
 			puts("ERROR: Unable to write import table.");
 	}
 
-	if (dependencies_out != NULL)
+	if (exports_out != NULL)
 	{
-		tmp_file = fopen(dependencies_out, "wb");
+		tmp_file = fopen(exports_out, "wb");
 		if (tmp_file != NULL)
 		{
-			print_dependency_list(tmp_file);
+			// the base package isn't kept open, and only this needs its exports
+			if (package_filename == NULL || open_package_file(&base_package, package_filename) == false)
+				puts("ERROR: Unable to read export table.");
+			else
+			{
+				if (print_export_table(tmp_file, &base_package) == false)
+					puts("ERROR: Malformed export table.");
+				else
+					printf("%u export table entries written.\n", base_package.summary.export_count);
+				close_package_file(&base_package);
+			}
 			fclose(tmp_file);
 		}
 		else
-			puts("ERROR: Unable to write dependency list.");
+			puts("ERROR: Unable to write export table.");
 	}
 
-	if (packages_out != NULL)
-	{
-		tmp_file = fopen(packages_out, "wb");
-		if (tmp_file != NULL)
-		{
-			print_package_table(tmp_file);
-			fclose(tmp_file);
-		}
-		else
-			puts("ERROR: Unable to write package table");
-	}
+	if (dependencies_out != NULL && write_table(dependencies_out, print_dependency_list) == false)
+		puts("ERROR: Unable to write dependency list.");
 
-	if (game_packages_out != NULL)
+	if (prune_out != NULL)
 	{
-		tmp_file = fopen(game_packages_out, "wb");
+		tmp_file = fopen(prune_out, "wb");
 		if (tmp_file != NULL)
 		{
-			print_game_package_table(tmp_file);
+			if (package_usage != NULL)
+				print_package_usage(tmp_file);
 			fclose(tmp_file);
 		}
 		else
-			puts("ERROR: Unable to write game package table");
+			puts("ERROR: Unable to write prune report.");
 	}
 
-	if (against_out != NULL)
+	if (packages_out != NULL && write_table(packages_out, print_package_table) == false)
+		puts("ERROR: Unable to write package table");
+
+	if (game_packages_out != NULL && write_table(game_packages_out, print_game_package_table) == false)
+		puts("ERROR: Unable to write game package table");
+
+	if (against_out != NULL && watch_game_path == false && save_against_list(against_out, legacy_against) == false)
+		puts("ERROR: Unable to write against list");
+	end_phase();
+
+	if (cache_filename != NULL)
 	{
-		tmp_file = fopen(against_out, "wb");
-		if (tmp_file != NULL)
-		{
-			write_against_list(tmp_file);
-			fclose(tmp_file);
-		}
-		else
-			puts("ERROR: Unable to write against list");
+		begin_phase("save_cache");
+		if (save_package_cache(cache_filename) == false)
+			puts("ERROR: Unable to write package cache");
+		end_phase();
 	}
 
-	return 0;
+	if (print_statistics)
+		print_stats(stdout);
+
+	if (trace_out != NULL && write_trace(trace_out) == false)
+		puts("ERROR: Unable to write trace");
+
+	if (work_pool != NULL)
+		work_pool_destroy(work_pool);
+
+	return batch_failures == 0 ? 0 : 1;
 }